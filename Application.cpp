@@ -10,6 +10,7 @@
 #include <fstream>      
 #include <sstream>      
 #include <iomanip>      
+#include <functional>
 
 
 std::atomic<Application*> Application::instance_{nullptr};
@@ -38,16 +39,47 @@ Application::~Application() {
 
 bool Application::initialize() {
     syslog(LOG_DEBUG, "[App::initialize] Начало инициализации...");
-    if (!udev_monitor_.initialize()) {
+    setupEventRoutes();
+    if (!udev_monitor_.initialize(router_.monitorFilters())) {
         syslog(LOG_CRIT, "[App::initialize] Ошибка инициализации UdevMonitor.");
         return false;
     }
+    if (duplicator_ && !duplicator_->start()) {
+        syslog(LOG_CRIT, "[App::initialize] Ошибка запуска режима дублирования.");
+        return false;
+    }
+    if (!control_socket_path_.empty()) {
+        control_.reset(new ControlServer(udev_monitor_, [this](const std::string& request) {
+            return handleControlCommand(request);
+        }));
+        if (!control_->start(control_socket_path_)) {
+            syslog(LOG_WARNING, "[App::initialize] Управляющий сокет недоступен, продолжаем без него.");
+            control_.reset();
+        }
+    }
     setupSignalHandlers();
     syslog(LOG_DEBUG, "[App::initialize] Инициализация завершена успешно.");
     return true;
 }
 
+void Application::enableDuplicator(const DuplicatorConfig& config) {
+    duplicator_.reset(new ImageDuplicator(config));
+    duplicator_->setResultCallback(&ResultDisplay::publishDuplicationResult);
+    syslog(LOG_INFO, "[App] Включен режим дублирования образа %s (проверка: %s).",
+           config.image_path.c_str(), config.verify ? "да" : "нет");
+}
+
 void Application::cleanup() {
+    if (control_) {
+        control_->stop();
+        control_.reset();
+    }
+    // Запущенные тесты отменяются и дожидаются до закрытия потоков вывода
+    scheduler_.shutdown();
+    if (duplicator_) {
+        duplicator_->stop();
+    }
+    ResultDisplay::closeSinks();
     syslog(LOG_INFO, "[App] Завершение работы USB Monitor.");
     closelog();
     if (!is_daemon_) {
@@ -58,6 +90,8 @@ void Application::cleanup() {
 void Application::setupSignalHandlers() {
     signal(SIGINT, Application::staticSignalHandler);
     signal(SIGTERM, Application::staticSignalHandler);
+    // Получатель потокового вывода может закрыть канал - это не повод завершаться
+    signal(SIGPIPE, SIG_IGN);
 }
 
 void Application::staticSignalHandler(int signum) {
@@ -87,7 +121,7 @@ int Application::run() {
     syslog(LOG_INFO, "[App::run] Инициализация успешна. Запуск UdevMonitor::run...");
     
     udev_monitor_.run([this](struct udev_device* dev){
-        this->onDeviceEvent(dev);
+        this->router_.dispatch(dev);
     });
 
     
@@ -143,159 +177,283 @@ bool Application::hasMassStorageInterface(struct udev_device* usb_dev) {
 
 
 
-void Application::onDeviceEvent(struct udev_device* dev) {
-    const char* action = udev_device_get_action(dev);
-    if (!action || (strcmp(action, "add") != 0 && strcmp(action, "remove") != 0)) {
-        return;
-    }
-
-    const char* subsystem = udev_device_get_subsystem(dev);
-    const char* devpath = udev_device_get_devpath(dev);
-    const char* devtype = udev_device_get_devtype(dev);
-
-    if (!subsystem || !devpath) {
-        syslog(LOG_WARNING, "[App::onDeviceEvent] Получено событие '%s' без подсистемы или пути.", action ? action : "unknown");
-        return;
-    }
+void Application::setupEventRoutes() {
+    using std::placeholders::_1;
+    router_.on("add", "usb", "usb_device", std::bind(&Application::onUsbDeviceAdd, this, _1));
+    router_.on("remove", "usb", "usb_device", std::bind(&Application::onUsbDeviceRemove, this, _1));
+    router_.on("add", "block", "disk", std::bind(&Application::onBlockDiskAdd, this, _1));
+    router_.on("add", "hid", nullptr, std::bind(&Application::onHidAdd, this, _1));
+    router_.on("add", "tty", nullptr, std::bind(&Application::onSerialAdd, this, _1));
+    router_.build();
+}
 
-    
-    if (strcmp(action, "remove") == 0 && strcmp(subsystem, "usb") == 0) {
-        auto it = active_devices_map_.find(devpath);
-        if (it != active_devices_map_.end()) {
-            syslog(LOG_INFO, "[App] USB устройство отключено: %s (Произв: %s, Устр: %s)",
-                    devpath, it->second.manufacturer.c_str(), it->second.product_name.c_str());
-            active_devices_map_.erase(it);
+void Application::onUsbDeviceRemove(const DeviceEvent& event) {
+    const char* devpath = event.devpath;
+    auto it = active_devices_map_.find(devpath);
+    if (it != active_devices_map_.end()) {
+        syslog(LOG_INFO, "[App] USB устройство отключено: %s (Произв: %s, Устр: %s)",
+                devpath, it->second.manufacturer.c_str(), it->second.product_name.c_str());
+        scheduler_.cancel(devpath);
+        if (duplicator_ && !it->second.block_device.empty()) {
+            duplicator_->removeTarget(it->second.block_device);
         }
-        return;
+        active_devices_map_.erase(it);
     }
+}
 
-    
-    if (strcmp(action, "add") == 0 && strcmp(subsystem, "usb") == 0 && devtype && strcmp(devtype, "usb_device") == 0) {
-        if (active_devices_map_.count(devpath)) {
-             syslog(LOG_DEBUG, "[App] Повторное событие USB add для %s, игнорируем базовую обработку.", devpath);
-             
-             if (!active_devices_map_[devpath].results_displayed && !active_devices_map_[devpath].is_likely_storage) {
-                 syslog(LOG_WARNING, "[App] Повторное USB add для %s (не накопитель), но окно еще не было показано. Показываем базовую информацию.", devpath);
-                 ResultDisplay::prepareAndDisplay(active_devices_map_[devpath], false);
-                 active_devices_map_[devpath].results_displayed = true; 
-             }
-             return;
-        }
+void Application::onUsbDeviceAdd(const DeviceEvent& event) {
+    struct udev_device* dev = event.dev;
+    const char* devpath = event.devpath;
+    if (active_devices_map_.count(devpath)) {
+         syslog(LOG_DEBUG, "[App] Повторное событие USB add для %s, игнорируем базовую обработку.", devpath);
+         
+         if (!active_devices_map_[devpath].results_displayed && !active_devices_map_[devpath].is_likely_storage) {
+             syslog(LOG_WARNING, "[App] Повторное USB add для %s (не накопитель), но окно еще не было показано. Показываем базовую информацию.", devpath);
+             std::string error;
+             scheduler_.start(active_devices_map_[devpath], false, TestProfile::Default, error);
+             active_devices_map_[devpath].results_displayed = true; 
+         }
+         return;
+    }
 
-        DeviceInfo info;
-        info.devpath = devpath;
-        info.results_displayed = false;
-        info.block_device = "";
-        info.capacity_gb = "N/A"; 
-
-        const char* vid = udev_device_get_sysattr_value(dev, "idVendor");
-        const char* pid = udev_device_get_sysattr_value(dev, "idProduct");
-        const char* manuf = udev_device_get_sysattr_value(dev, "manufacturer");
-        const char* prod = udev_device_get_sysattr_value(dev, "product");
-        info.vendor_id = vid ? vid : ""; info.product_id = pid ? pid : "";
-        info.manufacturer = manuf ? manuf : ""; info.product_name = prod ? prod : "";
-
-        syslog(LOG_INFO, "[App] Обработка USB add: VID=%s, PID=%s, Manuf='%s', Prod='%s', Path=%s",
-               info.vendor_id.c_str(), info.product_id.c_str(), info.manufacturer.c_str(), info.product_name.c_str(),
-               info.devpath.c_str());
-
-        info.is_likely_storage = hasMassStorageInterface(dev);
-        syslog(LOG_INFO, "[App] Устройство %s %s содержать Mass Storage интерфейс.",
-               info.devpath.c_str(), info.is_likely_storage ? "похоже, что" : "НЕ похоже, что");
-
-        active_devices_map_[info.devpath] = info; 
-
-        if (!info.is_likely_storage) {
-             syslog(LOG_INFO, "[App] Вызов отображения базовой информации для НЕ-накопителя %s", info.devpath.c_str());
-             ResultDisplay::prepareAndDisplay(info, false);
-             active_devices_map_[info.devpath].results_displayed = true; 
-        } else {
-             syslog(LOG_DEBUG, "[App] Устройство %s похоже на накопитель, ожидаем событие block add.", info.devpath.c_str());
-        }
-        return;
+    DeviceInfo info;
+    info.devpath = devpath;
+    info.results_displayed = false;
+    info.block_device = "";
+    info.capacity_gb = "N/A"; 
+
+    const char* vid = udev_device_get_sysattr_value(dev, "idVendor");
+    const char* pid = udev_device_get_sysattr_value(dev, "idProduct");
+    const char* manuf = udev_device_get_sysattr_value(dev, "manufacturer");
+    const char* prod = udev_device_get_sysattr_value(dev, "product");
+    info.vendor_id = vid ? vid : ""; info.product_id = pid ? pid : "";
+    info.manufacturer = manuf ? manuf : ""; info.product_name = prod ? prod : "";
+
+    syslog(LOG_INFO, "[App] Обработка USB add: VID=%s, PID=%s, Manuf='%s', Prod='%s', Path=%s",
+           info.vendor_id.c_str(), info.product_id.c_str(), info.manufacturer.c_str(), info.product_name.c_str(),
+           info.devpath.c_str());
+
+    info.is_likely_storage = hasMassStorageInterface(dev);
+    syslog(LOG_INFO, "[App] Устройство %s %s содержать Mass Storage интерфейс.",
+           info.devpath.c_str(), info.is_likely_storage ? "похоже, что" : "НЕ похоже, что");
+
+    active_devices_map_[info.devpath] = info; 
+
+    if (!info.is_likely_storage) {
+         syslog(LOG_INFO, "[App] Вызов отображения базовой информации для НЕ-накопителя %s", info.devpath.c_str());
+         std::string error;
+         scheduler_.start(info, false, TestProfile::Default, error);
+         active_devices_map_[info.devpath].results_displayed = true; 
+    } else {
+         syslog(LOG_DEBUG, "[App] Устройство %s похоже на накопитель, ожидаем событие block add.", info.devpath.c_str());
     }
+}
 
-    
-    if (strcmp(action, "add") == 0 && strcmp(subsystem, "block") == 0) {
-        const char* id_bus = udev_device_get_property_value(dev, "ID_BUS");
-        const char* id_type = udev_device_get_property_value(dev, "ID_TYPE");
-        const char* devnode = udev_device_get_devnode(dev);
-        const char* block_devtype = udev_device_get_devtype(dev);
-
-        syslog(LOG_DEBUG, "[App] Обработка block add: devpath=%s, devnode=%s, devtype=%s, ID_BUS=%s, ID_TYPE=%s",
-               devpath ? devpath : "N/A", devnode ? devnode : "N/A", block_devtype ? block_devtype : "N/A",
-               id_bus ? id_bus : "N/A", id_type ? id_type : "N/A");
-
-        if (devnode && block_devtype && strcmp(block_devtype, "disk") == 0 &&
-            id_bus && strcmp(id_bus, "usb") == 0 && id_type && strcmp(id_type, "disk") == 0)
-        {
-            syslog(LOG_INFO, "[App] Найдено блочное USB-устройство: %s", devnode);
-
-            struct udev_device* parent_usb_dev = udev_device_get_parent_with_subsystem_devtype(
-                                                    dev, "usb", "usb_device");
-
-            if (parent_usb_dev) {
-                const char* parent_devpath = udev_device_get_devpath(parent_usb_dev);
-                syslog(LOG_DEBUG, "[App] Найден родительский USB путь: %s для блочного устройства %s",
-                       parent_devpath ? parent_devpath : "N/A", devnode);
-
-                if (parent_devpath) {
-                    auto it = active_devices_map_.find(parent_devpath);
-                    if (it != active_devices_map_.end()) {
-                        DeviceInfo& stored_info = it->second;
-                        if (!stored_info.results_displayed) { 
-                            stored_info.block_device = devnode;
-
-                            
-                            stored_info.capacity_gb = "N/A"; 
-                            const char* device_name = strrchr(devnode, '/'); 
-                            if (device_name) {
-                                device_name++;
-                                std::string size_path = "/sys/block/";
-                                size_path += device_name;
-                                size_path += "/size";
-                                std::ifstream size_file(size_path);
-                                if (size_file.is_open()) {
-                                    unsigned long long sectors = 0;
-                                    if (size_file >> sectors) {
-                                        unsigned long long total_bytes = sectors * 512;
-                                        double capacity_gb_double = static_cast<double>(total_bytes) / (1024.0 * 1024.0 * 1024.0);
-                                        std::stringstream ss;
-                                        ss << std::fixed << std::setprecision(1) << capacity_gb_double;
-                                        stored_info.capacity_gb = ss.str();
-                                        syslog(LOG_INFO, "[App] Объем %s: %llu секторов = %s GB", devnode, sectors, stored_info.capacity_gb.c_str());
-                                    } else {
-                                        syslog(LOG_WARNING, "[App] Не удалось прочитать число секторов из %s", size_path.c_str());
-                                    }
-                                    size_file.close();
+void Application::onBlockDiskAdd(const DeviceEvent& event) {
+    struct udev_device* dev = event.dev;
+    const char* devpath = event.devpath;
+    const char* id_bus = udev_device_get_property_value(dev, "ID_BUS");
+    const char* id_type = udev_device_get_property_value(dev, "ID_TYPE");
+    const char* devnode = udev_device_get_devnode(dev);
+
+    syslog(LOG_DEBUG, "[App] Обработка block add: devpath=%s, devnode=%s, devtype=%s, ID_BUS=%s, ID_TYPE=%s",
+           devpath ? devpath : "N/A", devnode ? devnode : "N/A", event.devtype,
+           id_bus ? id_bus : "N/A", id_type ? id_type : "N/A");
+
+    if (devnode &&
+        id_bus && strcmp(id_bus, "usb") == 0 && id_type && strcmp(id_type, "disk") == 0)
+    {
+        syslog(LOG_INFO, "[App] Найдено блочное USB-устройство: %s", devnode);
+
+        struct udev_device* parent_usb_dev = udev_device_get_parent_with_subsystem_devtype(
+                                                dev, "usb", "usb_device");
+
+        if (parent_usb_dev) {
+            const char* parent_devpath = udev_device_get_devpath(parent_usb_dev);
+            syslog(LOG_DEBUG, "[App] Найден родительский USB путь: %s для блочного устройства %s",
+                   parent_devpath ? parent_devpath : "N/A", devnode);
+
+            if (parent_devpath) {
+                auto it = active_devices_map_.find(parent_devpath);
+                if (it != active_devices_map_.end()) {
+                    DeviceInfo& stored_info = it->second;
+                    if (!stored_info.results_displayed) { 
+                        stored_info.block_device = devnode;
+
+                        
+                        stored_info.capacity_gb = "N/A"; 
+                        const char* device_name = strrchr(devnode, '/'); 
+                        if (device_name) {
+                            device_name++;
+                            std::string size_path = "/sys/block/";
+                            size_path += device_name;
+                            size_path += "/size";
+                            std::ifstream size_file(size_path);
+                            if (size_file.is_open()) {
+                                unsigned long long sectors = 0;
+                                if (size_file >> sectors) {
+                                    unsigned long long total_bytes = sectors * 512;
+                                    double capacity_gb_double = static_cast<double>(total_bytes) / (1024.0 * 1024.0 * 1024.0);
+                                    std::stringstream ss;
+                                    ss << std::fixed << std::setprecision(1) << capacity_gb_double;
+                                    stored_info.capacity_gb = ss.str();
+                                    syslog(LOG_INFO, "[App] Объем %s: %llu секторов = %s GB", devnode, sectors, stored_info.capacity_gb.c_str());
                                 } else {
-                                     syslog(LOG_WARNING, "[App] Не удалось открыть файл sysfs для получения размера: %s", size_path.c_str());
+                                    syslog(LOG_WARNING, "[App] Не удалось прочитать число секторов из %s", size_path.c_str());
                                 }
+                                size_file.close();
                             } else {
-                                 syslog(LOG_WARNING, "[App] Не удалось извлечь имя устройства из %s", devnode);
+                                 syslog(LOG_WARNING, "[App] Не удалось открыть файл sysfs для получения размера: %s", size_path.c_str());
                             }
-                            
+                        } else {
+                             syslog(LOG_WARNING, "[App] Не удалось извлечь имя устройства из %s", devnode);
+                        }
+                        
 
-                            stored_info.results_displayed = true; 
-                            syslog(LOG_INFO, "[App] Связь установлена. ВЫЗОВ отображения/тестов для накопителя %s (%s)",
+                        stored_info.results_displayed = true; 
+                        if (duplicator_) {
+                            syslog(LOG_INFO, "[App] Связь установлена. Накопитель %s (%s) добавлен как цель дублирования.",
                                    parent_devpath, devnode);
-                            ResultDisplay::prepareAndDisplay(stored_info, true); 
+                            duplicator_->addTarget(devnode);
                         } else {
-                             syslog(LOG_DEBUG, "[App] Окно для USB %s уже было показано, игнорируем событие block add для %s.", parent_devpath, devnode);
+                            syslog(LOG_INFO, "[App] Связь установлена. ВЫЗОВ отображения/тестов для накопителя %s (%s)",
+                                   parent_devpath, devnode);
+                            std::string error;
+                            if (!scheduler_.start(stored_info, true, TestProfile::Default, error)) {
+                                syslog(LOG_WARNING, "[App] Тест %s не запущен: %s", devnode, error.c_str());
+                            }
                         }
                     } else {
-                        syslog(LOG_WARNING, "[App] !!! Не найдена информация о USB-родителе %s в карте для %s при событии block add.", parent_devpath, devnode);
-                         
+                         syslog(LOG_DEBUG, "[App] Окно для USB %s уже было показано, игнорируем событие block add для %s.", parent_devpath, devnode);
                     }
-                } else { syslog(LOG_WARNING, "[App] Не удалось получить devpath для родительского USB устройства %s", devnode); }
+                } else {
+                    syslog(LOG_WARNING, "[App] !!! Не найдена информация о USB-родителе %s в карте для %s при событии block add.", parent_devpath, devnode);
+                     
+                }
+            } else { syslog(LOG_WARNING, "[App] Не удалось получить devpath для родительского USB устройства %s", devnode); }
+        } else {
+            syslog(LOG_WARNING, "[App] Не удалось найти родительское USB устройство для %s при событии block add.", devnode);
+        }
+    }
+}
+
+// Находит запись родительского USB-устройства для интерфейсных событий (HID, tty)
+DeviceInfo* Application::findParentUsbDevice(struct udev_device* dev) {
+    struct udev_device* parent_usb_dev = udev_device_get_parent_with_subsystem_devtype(dev, "usb", "usb_device");
+    if (!parent_usb_dev) return nullptr;
+    const char* parent_devpath = udev_device_get_devpath(parent_usb_dev);
+    if (!parent_devpath) return nullptr;
+    auto it = active_devices_map_.find(parent_devpath);
+    return it != active_devices_map_.end() ? &it->second : nullptr;
+}
+
+void Application::onHidAdd(const DeviceEvent& event) {
+    DeviceInfo* parent = findParentUsbDevice(event.dev);
+    if (!parent) return;   // HID не через USB (Bluetooth, I2C) - не наше
+    const char* hid_name = udev_device_get_property_value(event.dev, "HID_NAME");
+    const char* hid_id = udev_device_get_property_value(event.dev, "HID_ID");
+    syslog(LOG_INFO, "[App] HID интерфейс USB устройства %s: '%s' (HID_ID=%s)",
+           parent->devpath.c_str(), hid_name ? hid_name : "N/A", hid_id ? hid_id : "N/A");
+}
+
+void Application::onSerialAdd(const DeviceEvent& event) {
+    const char* driver = udev_device_get_property_value(event.dev, "ID_USB_DRIVER");
+    if (!driver || strcmp(driver, "cdc_acm") != 0) return;
+    DeviceInfo* parent = findParentUsbDevice(event.dev);
+    const char* devnode = udev_device_get_devnode(event.dev);
+    syslog(LOG_INFO, "[App] CDC-ACM порт %s USB устройства %s",
+           devnode ? devnode : "N/A", parent ? parent->devpath.c_str() : "N/A");
+}
+
+// Устройство по devpath USB или по узлу блочного устройства (/dev/sdX)
+DeviceInfo* Application::findDevice(const std::string& key) {
+    auto it = active_devices_map_.find(key);
+    if (it != active_devices_map_.end()) return &it->second;
+    for (auto& entry : active_devices_map_) {
+        if (!entry.second.block_device.empty() && entry.second.block_device == key) return &entry.second;
+    }
+    return nullptr;
+}
+
+std::string Application::handleControlCommand(const std::string& request) {
+    std::istringstream in(request);
+    std::string command, arg1, arg2;
+    in >> command >> arg1 >> arg2;
+    syslog(LOG_DEBUG, "[Control] Команда: '%s'", request.c_str());
+
+    if (command == "list") {
+        std::ostringstream out;
+        out << "OK " << active_devices_map_.size() << "\n";
+        for (const auto& entry : active_devices_map_) {
+            const DeviceInfo& info = entry.second;
+            TestScheduler::JobInfo job = scheduler_.job(info.devpath);
+            out << "{\"devpath\":" << ResultSink::jsonString(info.devpath.c_str())
+                << ",\"vid\":" << ResultSink::jsonString(info.vendor_id.c_str())
+                << ",\"pid\":" << ResultSink::jsonString(info.product_id.c_str())
+                << ",\"manufacturer\":" << ResultSink::jsonString(info.manufacturer.c_str())
+                << ",\"product\":" << ResultSink::jsonString(info.product_name.c_str())
+                << ",\"storage\":" << (info.is_likely_storage ? "true" : "false")
+                << ",\"block_device\":" << ResultSink::jsonString(info.block_device.c_str())
+                << ",\"capacity_gb\":" << ResultSink::jsonString(info.capacity_gb.c_str())
+                << ",\"test\":";
+            if (job.running) {
+                out << "\"" << TestScheduler::profileName(job.profile) << "\",\"test_seconds\":"
+                    << std::fixed << std::setprecision(1) << job.seconds;
             } else {
-                syslog(LOG_WARNING, "[App] Не удалось найти родительское USB устройство для %s при событии block add.", devnode);
+                out << "null";
             }
+            out << "}\n";
         }
-        return;
+        return out.str();
     }
-     if (strcmp(action, "add") == 0) {
-        syslog(LOG_DEBUG, "[App] Игнорируется событие add: subsystem=%s, devtype=%s, devpath=%s",
-            subsystem, devtype ? devtype : "N/A", devpath);
+
+    if (command == "test") {
+        DeviceInfo* info = findDevice(arg1);
+        if (!info) return "ERR устройство не найдено: " + arg1 + "\n";
+        TestProfile profile;
+        if (!TestScheduler::parseProfile(arg2, profile)) return "ERR неизвестный профиль: " + arg2 + "\n";
+        bool is_storage = info->is_likely_storage && !info->block_device.empty();
+        if (!is_storage && profile != TestProfile::Default) {
+            return "ERR у устройства нет блочного устройства для теста\n";
+        }
+        if (duplicator_ && is_storage) return "ERR накопитель используется режимом дублирования\n";
+        std::string error;
+        if (!scheduler_.start(*info, is_storage, profile, error)) return "ERR " + error + "\n";
+        info->results_displayed = true;
+        return std::string("OK тест '") + TestScheduler::profileName(profile) + "' запущен для " + info->devpath + "\n";
+    }
+
+    if (command == "cancel") {
+        DeviceInfo* info = findDevice(arg1);
+        if (!info) return "ERR устройство не найдено: " + arg1 + "\n";
+        if (!scheduler_.cancel(info->devpath)) return "ERR тест не выполняется\n";
+        return "OK отмена запрошена\n";
     }
-}
\ No newline at end of file
+
+    if (command == "results") {
+        // results [УСТРОЙСТВО] [N]; единственный числовой аргумент - это N
+        std::string filter = arg1;
+        std::string limit_str = arg2;
+        if (!arg1.empty() && arg2.empty() && arg1.find_first_not_of("0123456789") == std::string::npos) {
+            filter.clear();
+            limit_str = arg1;
+        }
+        // Записи дублирования не привязаны к USB-устройству, только к узлу блочного
+        // устройства, поэтому ищем и по devpath, и по блочному устройству
+        std::string devpath = filter;
+        std::string target = filter;
+        DeviceInfo* info = filter.empty() ? nullptr : findDevice(filter);
+        if (info) {
+            devpath = info->devpath;
+            if (!info->block_device.empty()) target = info->block_device;
+        }
+        size_t limit = limit_str.empty() ? 10 : static_cast<size_t>(std::strtoul(limit_str.c_str(), nullptr, 10));
+        std::vector<std::string> results = ResultDisplay::recentResults(devpath, target, limit);
+        std::ostringstream out;
+        out << "OK " << results.size() << "\n";
+        for (const auto& line : results) out << line;
+        return out.str();
+    }
+
+    return "ERR неизвестная команда: '" + command + "' (list, test, cancel, results)\n";
+}
@@ -1,8 +1,13 @@
 #pragma once
 
 #include "UdevMonitor.h"
+#include "EventRouter.h"
 #include "DeviceInfo.h"
+#include "ImageDuplicator.h"
+#include "TestScheduler.h"
+#include "ControlServer.h"
 #include <map>
+#include <memory>
 #include <string>
 #include <atomic>
 #include <csignal> 
@@ -16,6 +21,11 @@ public:
 
     int run(); 
 
+    // Режим дублирования: образ записывается на каждый обнаруженный накопитель
+    void enableDuplicator(const DuplicatorConfig& config);
+    // Пустой путь отключает управляющий сокет
+    void setControlSocketPath(const std::string& path) { control_socket_path_ = path; }
+
 private:
     bool initialize();
     void cleanup();
@@ -24,14 +34,30 @@ private:
     static void staticSignalHandler(int signum); 
     void handleSignal(int signum);        
 
-    void onDeviceEvent(struct udev_device* dev);
+    // Обработчики событий udev, регистрируются в router_
+    void setupEventRoutes();
+    void onUsbDeviceAdd(const DeviceEvent& event);
+    void onUsbDeviceRemove(const DeviceEvent& event);
+    void onBlockDiskAdd(const DeviceEvent& event);
+    void onHidAdd(const DeviceEvent& event);
+    void onSerialAdd(const DeviceEvent& event);
+    DeviceInfo* findParentUsbDevice(struct udev_device* dev);
+
+    // Команды управляющего сокета: list, test, cancel, results
+    std::string handleControlCommand(const std::string& request);
+    DeviceInfo* findDevice(const std::string& key);
 
     // Проверка интерфейса Mass Storage
     bool hasMassStorageInterface(struct udev_device* usb_dev);
 
     bool is_daemon_;
     UdevMonitor udev_monitor_;
+    EventRouter router_;
     std::map<std::string, DeviceInfo> active_devices_map_;
+    std::unique_ptr<ImageDuplicator> duplicator_;
+    TestScheduler scheduler_;
+    std::unique_ptr<ControlServer> control_;
+    std::string control_socket_path_ = ControlProtocol::kDefaultSocketPath;
 
     // Статические члены для обработки сигналов
     static std::atomic<Application*> instance_; // Указатель на текущий экземпляр
@@ -0,0 +1,96 @@
+// usb_monitor_ctl: клиент управляющего сокета usb_monitor
+#include "ControlProtocol.h"
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static void printUsage(const char* prog) {
+    std::cout << "Использование: " << prog << " [-s СОКЕТ] КОМАНДА [АРГУМЕНТЫ]\n"
+              << "  list                          подключенные устройства и выполняемые тесты\n"
+              << "  test УСТРОЙСТВО [ПРОФИЛЬ]     запустить тест: default, read, fs, full\n"
+              << "  cancel УСТРОЙСТВО             отменить выполняемый тест\n"
+              << "  results [УСТРОЙСТВО] [N]      последние N результатов (по умолчанию 10)\n"
+              << "УСТРОЙСТВО - devpath USB-устройства или узел блочного устройства (/dev/sdX).\n"
+              << "Сокет по умолчанию: " << ControlProtocol::kDefaultSocketPath << "\n";
+}
+
+static bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::string socket_path = ControlProtocol::kDefaultSocketPath;
+    int first = 1;
+    if (argc > 2 && std::strcmp(argv[1], "-s") == 0) {
+        socket_path = argv[2];
+        first = 3;
+    }
+    if (first >= argc || std::strcmp(argv[first], "-h") == 0 || std::strcmp(argv[first], "--help") == 0) {
+        printUsage(argv[0]);
+        return first >= argc ? 1 : 0;
+    }
+
+    std::string request;
+    for (int i = first; i < argc; ++i) {
+        if (i > first) request += ' ';
+        request += argv[i];
+    }
+    request += '\n';
+    if (request.size() > ControlProtocol::kMaxRequestSize) {
+        std::cerr << "Слишком длинный запрос." << std::endl;
+        return 1;
+    }
+
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Слишком длинный путь сокета: " << socket_path << std::endl;
+        return 1;
+    }
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "Не удалось подключиться к " << socket_path << ": " << strerror(errno) << std::endl;
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+    // Сервер может отказать (занят) до чтения запроса - ответ всё равно читаем
+    int send_errno = sendAll(fd, request) ? 0 : errno;
+    shutdown(fd, SHUT_WR);
+
+    std::string response;
+    char buf[4096];
+    while (true) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n > 0) {
+            response.append(buf, n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        break;
+    }
+    close(fd);
+
+    if (response.empty() && send_errno != 0) {
+        std::cerr << "Ошибка отправки запроса: " << strerror(send_errno) << std::endl;
+        return 1;
+    }
+    std::cout << response;
+    if (!response.empty() && response[response.size() - 1] != '\n') std::cout << std::endl;
+    return response.compare(0, 2, "OK") == 0 ? 0 : 1;
+}
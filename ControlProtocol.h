@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+// Протокол управляющего сокета (usb_monitor <-> usb_monitor_ctl).
+// Один запрос на соединение: строка "КОМАНДА [АРГУМЕНТЫ]\n".
+// Ответ: "OK [сообщение]" или "ERR сообщение", затем строки данных (JSON);
+// сервер закрывает соединение после ответа.
+//   list                          - подключенные устройства и выполняемые тесты
+//   test УСТРОЙСТВО [ПРОФИЛЬ]     - запуск теста: default, read, fs, full
+//   cancel УСТРОЙСТВО             - отмена выполняемого теста
+//   results [УСТРОЙСТВО] [N]      - последние N результатов из кэша
+// УСТРОЙСТВО - devpath USB-устройства или узел блочного устройства (/dev/sdX).
+namespace ControlProtocol {
+    const char* const kDefaultSocketPath = "/run/usb_monitor.sock";
+    const size_t kMaxRequestSize = 4096;
+}
@@ -0,0 +1,216 @@
+#include "ControlServer.h"
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <syslog.h>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+const std::chrono::seconds ControlServer::kClientTimeout(5);
+
+ControlServer::ControlServer(UdevMonitor& loop, CommandHandler handler)
+    : loop_(loop), handler_(std::move(handler)) {}
+
+ControlServer::~ControlServer() {
+    stop();
+}
+
+bool ControlServer::start(const std::string& socket_path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.empty() || socket_path.size() >= sizeof(addr.sun_path)) {
+        syslog(LOG_WARNING, "[Control] Недопустимый путь сокета: '%s'", socket_path.c_str());
+        return false;
+    }
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        syslog(LOG_WARNING, "[Control] socket: %s", strerror(errno));
+        return false;
+    }
+
+    // Сокет, оставшийся от предыдущего запуска, удаляем, только если его никто не слушает
+    struct stat st;
+    if (lstat(socket_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        bool alive = probe >= 0 &&
+                     (connect(probe, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 || errno == EAGAIN);
+        if (probe >= 0) close(probe);
+        if (alive) {
+            syslog(LOG_WARNING, "[Control] %s уже используется другим экземпляром usb_monitor.", socket_path.c_str());
+            close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+        unlink(socket_path.c_str());
+    }
+
+    // Демон работает с umask(0): сокет сразу создаётся с доступом только для владельца
+    mode_t old_umask = umask(077);
+    int bound = bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    umask(old_umask);
+    if (bound < 0 || listen(listen_fd_, 8) < 0) {
+        syslog(LOG_WARNING, "[Control] Не удалось открыть %s: %s", socket_path.c_str(), strerror(errno));
+        if (bound == 0) unlink(socket_path.c_str());
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    socket_path_ = socket_path;
+
+    setListening(true);
+    if (!listening_) {
+        stop();
+        return false;
+    }
+    loop_.setTickCallback([this] { onTick(); });
+    syslog(LOG_INFO, "[Control] Управляющий сокет: %s", socket_path_.c_str());
+    return true;
+}
+
+void ControlServer::stop() {
+    loop_.setTickCallback(nullptr);
+    std::vector<int> fds;
+    for (auto& entry : clients_) fds.push_back(entry.first);
+    for (int fd : fds) closeClient(fd);
+
+    if (listen_fd_ >= 0) {
+        setListening(false);
+        close(listen_fd_);
+        listen_fd_ = -1;
+        unlink(socket_path_.c_str());
+    }
+}
+
+void ControlServer::setListening(bool listening) {
+    if (listening == listening_ || listen_fd_ < 0) return;
+    if (listening) {
+        listening_ = loop_.watchFd(listen_fd_, false, [this](int, bool, bool) { onListenReady(); });
+    } else {
+        loop_.unwatchFd(listen_fd_);
+        listening_ = false;
+    }
+}
+
+void ControlServer::onListenReady() {
+    while (true) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EMFILE || errno == ENFILE) {
+                // Сокет остаётся читаемым: без паузы цикл крутился бы вхолостую
+                syslog(LOG_WARNING, "[Control] accept: %s, приём подключений приостановлен.", strerror(errno));
+                setListening(false);
+                resume_at_ = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                syslog(LOG_WARNING, "[Control] accept: %s", strerror(errno));
+            }
+            return;
+        }
+        if (clients_.size() >= kMaxClients) {
+            static const char kBusy[] = "ERR слишком много подключений\n";
+            send(fd, kBusy, sizeof(kBusy) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+            close(fd);
+            continue;
+        }
+        bool watched = loop_.watchFd(fd, false, [this](int cfd, bool readable, bool writable) {
+            onClientReady(cfd, readable, writable);
+        });
+        if (!watched) {
+            close(fd);
+            continue;
+        }
+        Client& client = clients_[fd];
+        client.deadline = std::chrono::steady_clock::now() + kClientTimeout;
+    }
+}
+
+void ControlServer::onTick() {
+    auto now = std::chrono::steady_clock::now();
+    std::vector<int> expired;
+    for (auto& entry : clients_) {
+        if (now >= entry.second.deadline) expired.push_back(entry.first);
+    }
+    for (int fd : expired) {
+        syslog(LOG_DEBUG, "[Control] Клиент fd %d не уложился в таймаут, соединение закрыто.", fd);
+        closeClient(fd);
+    }
+    if (!listening_ && now >= resume_at_) {
+        setListening(true);
+    }
+}
+
+void ControlServer::onClientReady(int fd, bool readable, bool writable) {
+    auto it = clients_.find(fd);
+    if (it == clients_.end()) return;
+    Client& client = it->second;
+
+    if (readable && !client.responded) {
+        char buf[1024];
+        bool eof = false;
+        while (true) {
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n > 0) {
+                client.in.append(buf, n);
+                if (client.in.size() > ControlProtocol::kMaxRequestSize) break;
+                continue;
+            }
+            if (n == 0) eof = true;
+            else if (errno == EINTR) continue;
+            else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                closeClient(fd);
+                return;
+            }
+            break;
+        }
+
+        size_t newline = client.in.find('\n');
+        if (newline == std::string::npos && client.in.size() > ControlProtocol::kMaxRequestSize) {
+            client.out = "ERR слишком длинный запрос\n";
+        } else if (newline != std::string::npos || (eof && !client.in.empty())) {
+            std::string request = client.in.substr(0, newline);
+            if (!request.empty() && request.back() == '\r') request.pop_back();
+            client.out = handler_(request);
+        } else if (eof) {
+            closeClient(fd);
+            return;
+        } else {
+            return;
+        }
+        client.responded = true;
+        // Клиент мог сделать shutdown(SHUT_WR): EOF держал бы fd читаемым и цикл крутился бы
+        loop_.setWantRead(fd, false);
+        writable = true;
+    }
+
+    if (writable && client.responded) {
+        while (client.out_pos < client.out.size()) {
+            ssize_t n = send(fd, client.out.data() + client.out_pos,
+                             client.out.size() - client.out_pos, MSG_NOSIGNAL);
+            if (n > 0) {
+                client.out_pos += n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                loop_.setWantWrite(fd, true);
+                return;
+            }
+            break;
+        }
+        closeClient(fd);
+    }
+}
+
+void ControlServer::closeClient(int fd) {
+    loop_.unwatchFd(fd);
+    close(fd);
+    clients_.erase(fd);
+    // Освободился дескриптор - можно снова принимать подключения
+    resume_at_ = std::chrono::steady_clock::time_point();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "UdevMonitor.h"
+#include "ControlProtocol.h"
+#include <functional>
+#include <map>
+#include <string>
+#include <chrono>
+
+// Управляющий Unix-сокет, обслуживаемый циклом событий UdevMonitor.
+// Все сокеты неблокирующие; команда выполняется обработчиком в том же цикле.
+// Клиентов не больше kMaxClients, каждый должен уложиться в kClientTimeout.
+class ControlServer {
+public:
+    // Возвращает полный текст ответа (с завершающим переводом строки)
+    using CommandHandler = std::function<std::string(const std::string& request)>;
+
+    ControlServer(UdevMonitor& loop, CommandHandler handler);
+    ~ControlServer();
+
+    bool start(const std::string& socket_path);
+    void stop();
+
+private:
+    static const size_t kMaxClients = 32;
+    static const std::chrono::seconds kClientTimeout;
+
+    struct Client {
+        std::chrono::steady_clock::time_point deadline;
+        std::string in;
+        std::string out;
+        size_t out_pos = 0;
+        bool responded = false;
+    };
+
+    void onListenReady();
+    void onClientReady(int fd, bool readable, bool writable);
+    void onTick();
+    void closeClient(int fd);
+    void setListening(bool listening);
+
+    UdevMonitor& loop_;
+    CommandHandler handler_;
+    std::string socket_path_;
+    int listen_fd_ = -1;
+    bool listening_ = false;          // false: нет свободных fd, accept приостановлен
+    std::chrono::steady_clock::time_point resume_at_;
+    std::map<int, Client> clients_;
+};
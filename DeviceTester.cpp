@@ -18,7 +18,9 @@ bool DeviceTester::check_data_integrity(const char* buffer_written, const char*
      return memcmp(buffer_written, buffer_read, size) == 0;
 }
 
-void DeviceTester::perform_tests_read_only(const std::string& block_dev_path, std::ostream& out_stream) {
+ReadTestResult DeviceTester::perform_tests_read_only(const std::string& block_dev_path, std::ostream& out_stream,
+                                                    const std::atomic<bool>* cancel) {
+    ReadTestResult result;
     out_stream << "\n--- Тестирование чтения с устройства: " << block_dev_path << " ---\n";
     syslog(LOG_INFO, "[TesterRO] Начало тестирования ЧТЕНИЯ устройства: %s", block_dev_path.c_str());
 
@@ -26,7 +28,8 @@ void DeviceTester::perform_tests_read_only(const std::string& block_dev_path, st
         syslog(LOG_WARNING, "[TesterRO] Нет блочного устройства для тестирования чтения.");
         out_stream << "ОШИБКА: Нет блочного устройства для тестирования чтения.\n";
         out_stream << "--- Тестирование чтения завершено с ошибкой ---\n";
-        return;
+        result.error = "нет блочного устройства";
+        return result;
     }
 
     // Открываем устройство ТОЛЬКО для чтения
@@ -36,7 +39,8 @@ void DeviceTester::perform_tests_read_only(const std::string& block_dev_path, st
         syslog(LOG_ERR, "[TesterRO] Не удалось открыть устройство %s для чтения: %s (%d)", block_dev_path.c_str(), error_msg.c_str(), errno);
         out_stream << "ОШИБКА: Не удалось открыть устройство " << block_dev_path << " для чтения: " << error_msg << "\n";
         out_stream << "--- Тестирование чтения завершено с ошибкой ---\n";
-        return;
+        result.error = error_msg;
+        return result;
     }
 
     const size_t block_size = 4096;             // Размер блока для чтения
@@ -51,6 +55,13 @@ void DeviceTester::perform_tests_read_only(const std::string& block_dev_path, st
     ssize_t current_read_bytes;
 
     while (bytes_read_total < total_size_to_read) {
+        if (cancel && cancel->load()) {
+            syslog(LOG_INFO, "[TesterRO] Тест чтения %s отменен (прочитано %zu байт).", block_dev_path.c_str(), bytes_read_total);
+            out_stream << "  Тест чтения: ОТМЕНЕН\n";
+            result.error = "отменено";
+            read_ok = false;
+            break;
+        }
         current_read_bytes = read(fd, read_buffer.data(), block_size);
 
         if (current_read_bytes < 0) { // Ошибка чтения
@@ -60,6 +71,7 @@ void DeviceTester::perform_tests_read_only(const std::string& block_dev_path, st
             out_stream << "  ОШИБКА чтения (прочитано " << (bytes_read_total / (1024.0 * 1024.0))
                        << " MB): " << error_msg << "\n";
             read_ok = false;
+            result.error = error_msg;
             break;
         }
 
@@ -72,9 +84,14 @@ void DeviceTester::perform_tests_read_only(const std::string& block_dev_path, st
     }
     long long end_time_read = current_time_ms();
     double read_duration = (end_time_read - start_time_read) / 1000.0;
+    result.performed = true;
+    result.bytes_read = bytes_read_total;
+    result.seconds = read_duration;
 
     if (read_ok && bytes_read_total > 0) {
         double read_speed = (read_duration > 0.0001) ? (bytes_read_total / (1024.0 * 1024.0)) / read_duration : 0;
+        result.ok = true;
+        result.mb_per_sec = read_speed;
         out_stream << std::fixed << std::setprecision(2);
         out_stream << "  Прочитано: " << (bytes_read_total / (1024.0 * 1024.0)) << " MB\n";
         out_stream << std::setprecision(3);
@@ -84,11 +101,13 @@ void DeviceTester::perform_tests_read_only(const std::string& block_dev_path, st
         syslog(LOG_INFO, "[TesterRO] Тест чтения %s: %.2f MB/s (прочитано %.2f MB)",
                block_dev_path.c_str(), read_speed, (bytes_read_total / (1024.0 * 1024.0)));
     } else if (!read_ok) {
-        out_stream << "  Тест чтения: НЕУДАЧА (ошибка во время чтения)\n";
+        if (result.error != "отменено") out_stream << "  Тест чтения: НЕУДАЧА (ошибка во время чтения)\n";
     } else { // bytes_read_total == 0
         out_stream << "  Тест чтения: Не удалось прочитать данные (0 байт).\n";
+        result.error = "прочитано 0 байт";
         syslog(LOG_WARNING, "[TesterRO] Тест чтения %s: 0 байт прочитано.", block_dev_path.c_str());
     }
     out_stream << "--- Тестирование чтения завершено ---\n";
     close(fd);
+    return result;
 }
\ No newline at end of file
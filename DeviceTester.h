@@ -2,12 +2,26 @@
 
 #include <string>
 #include <ostream>
+#include <atomic>
+
+struct ReadTestResult {
+    bool performed = false;
+    bool ok = false;
+    unsigned long long bytes_read = 0;
+    double seconds = 0.0;
+    double mb_per_sec = 0.0;
+    std::string error;
+};
 
 class DeviceTester {
 public:
-    void perform_tests_read_only(const std::string& block_dev_path, std::ostream& out_stream);
+    // cancel проверяется на каждом блоке, тест прерывается за миллисекунды
+    ReadTestResult perform_tests_read_only(const std::string& block_dev_path, std::ostream& out_stream,
+                                           const std::atomic<bool>* cancel = nullptr);
+
+    // Используется также ImageDuplicator для проверки записанного образа
+    static bool check_data_integrity(const char* buffer_written, const char* buffer_read, size_t size);
 
 private:
     static long long current_time_ms();
-    static bool check_data_integrity(const char* buffer_written, const char* buffer_read, size_t size);
 };
\ No newline at end of file
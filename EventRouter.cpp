@@ -0,0 +1,106 @@
+#include "EventRouter.h"
+#include <libudev.h>
+#include <syslog.h>
+#include <cstring>
+
+int EventRouter::intern(std::vector<std::string>& names, const char* name) {
+    int id = resolve(names, name);
+    if (id != 0) return id;
+    names.push_back(name);
+    return static_cast<int>(names.size() - 1);
+}
+
+int EventRouter::resolve(const std::vector<std::string>& names, const char* name) {
+    if (!name) return 0;
+    // Словари из нескольких элементов: линейный strcmp дешевле хеширования
+    for (size_t i = 1; i < names.size(); ++i) {
+        if (strcmp(names[i].c_str(), name) == 0) return static_cast<int>(i);
+    }
+    return 0;
+}
+
+void EventRouter::on(const char* action, const char* subsystem, const char* devtype, Handler handler) {
+    Route route;
+    route.action_id = intern(actions_, action);
+    route.subsystem_id = intern(subsystems_, subsystem);
+    route.devtype_id = devtype ? intern(devtypes_, devtype) : 0;
+    route.handler = handler;
+    routes_.push_back(route);
+}
+
+void EventRouter::build() {
+    const size_t n_sub = subsystems_.size();
+    const size_t n_dev = devtypes_.size();
+    table_.assign(actions_.size() * n_sub * n_dev, -1);
+
+    // Сначала общие маршруты, затем конкретные devtype поверх них
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t r = 0; r < routes_.size(); ++r) {
+            const Route& route = routes_[r];
+            bool wildcard = route.devtype_id == 0;
+            if ((pass == 0) != wildcard) continue;
+            size_t base = (route.action_id * n_sub + route.subsystem_id) * n_dev;
+            if (wildcard) {
+                for (size_t d = 0; d < n_dev; ++d) table_[base + d] = static_cast<int>(r);
+            } else {
+                table_[base + route.devtype_id] = static_cast<int>(r);
+            }
+        }
+    }
+    syslog(LOG_DEBUG, "[Router] Таблица маршрутов построена: %zu обработчиков, %zu x %zu x %zu.",
+           routes_.size(), actions_.size(), n_sub, n_dev);
+}
+
+bool EventRouter::dispatch(struct udev_device* dev) const {
+    if (table_.empty()) return false;
+
+    DeviceEvent event;
+    event.dev = dev;
+    event.action = udev_device_get_action(dev);
+    event.subsystem = udev_device_get_subsystem(dev);
+
+    int action_id = resolve(actions_, event.action);
+    if (action_id == 0) return false;
+    int subsystem_id = resolve(subsystems_, event.subsystem);
+    if (subsystem_id == 0) return false;
+
+    event.devtype = udev_device_get_devtype(dev);
+    int devtype_id = resolve(devtypes_, event.devtype);
+    int route = table_[(action_id * subsystems_.size() + subsystem_id) * devtypes_.size() + devtype_id];
+    if (route < 0) return false;
+
+    event.devpath = udev_device_get_devpath(dev);
+    if (!event.devpath) {
+        syslog(LOG_WARNING, "[Router] Получено событие '%s' (%s) без пути устройства.", event.action, event.subsystem);
+        return false;
+    }
+    routes_[route].handler(event);
+    return true;
+}
+
+std::vector<UdevMonitor::Filter> EventRouter::monitorFilters() const {
+    std::vector<UdevMonitor::Filter> filters;
+    for (size_t s = 1; s < subsystems_.size(); ++s) {
+        bool any_devtype = false;
+        std::vector<int> devtype_ids;
+        for (size_t r = 0; r < routes_.size(); ++r) {
+            if (routes_[r].subsystem_id != static_cast<int>(s)) continue;
+            if (routes_[r].devtype_id == 0) {
+                any_devtype = true;
+            } else {
+                bool seen = false;
+                for (size_t i = 0; i < devtype_ids.size(); ++i) seen = seen || devtype_ids[i] == routes_[r].devtype_id;
+                if (!seen) devtype_ids.push_back(routes_[r].devtype_id);
+            }
+        }
+        // Фильтр сокета udev не умеет отбирать по action - только subsystem/devtype
+        if (any_devtype) {
+            filters.push_back(UdevMonitor::Filter{subsystems_[s], ""});
+        } else {
+            for (size_t i = 0; i < devtype_ids.size(); ++i) {
+                filters.push_back(UdevMonitor::Filter{subsystems_[s], devtypes_[devtype_ids[i]]});
+            }
+        }
+    }
+    return filters;
+}
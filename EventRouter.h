@@ -0,0 +1,54 @@
+#pragma once
+
+#include "UdevMonitor.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+struct udev_device;
+
+struct DeviceEvent {
+    struct udev_device* dev;
+    const char* action;
+    const char* subsystem;
+    const char* devtype;     // Может быть nullptr
+    const char* devpath;
+};
+
+// Маршрутизация событий udev по ключу (action, subsystem, devtype).
+// Строки ключей интернируются в целые ID при регистрации, таблица обработчиков
+// строится один раз в build(); на каждое событие - три поиска ID и одно обращение к таблице.
+class EventRouter {
+public:
+    using Handler = std::function<void(const DeviceEvent& event)>;
+
+    // devtype == nullptr - любой тип устройства в подсистеме.
+    // Обработчик с конкретным devtype имеет приоритет над общим.
+    void on(const char* action, const char* subsystem, const char* devtype, Handler handler);
+
+    void build();
+
+    // false - событие не интересует ни один обработчик
+    bool dispatch(struct udev_device* dev) const;
+
+    // Фильтры для сокета udev, выведенные из зарегистрированных обработчиков
+    std::vector<UdevMonitor::Filter> monitorFilters() const;
+
+private:
+    struct Route {
+        int action_id;
+        int subsystem_id;
+        int devtype_id;      // 0 - любой
+        Handler handler;
+    };
+
+    static int intern(std::vector<std::string>& names, const char* name);
+    static int resolve(const std::vector<std::string>& names, const char* name);
+
+    // ID 0 в каждом словаре зарезервирован: "неизвестно" / "любой"
+    std::vector<std::string> actions_{""};
+    std::vector<std::string> subsystems_{""};
+    std::vector<std::string> devtypes_{""};
+    std::vector<Route> routes_;
+    std::vector<int> table_;     // [action][subsystem][devtype] -> индекс в routes_ или -1
+};
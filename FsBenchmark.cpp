@@ -0,0 +1,346 @@
+#include "FsBenchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <syslog.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <climits>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+namespace {
+
+const size_t kSeqBlockSize = 1024 * 1024;
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsed_us(const Clock::time_point& start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// В /proc/self/mounts пробелы и прочие спецсимволы записаны как \ooo
+std::string unescape_mount_path(const std::string& s) {
+    std::string out;
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '\\' && i + 3 < s.size()) {
+            int v = 0;
+            bool octal = true;
+            for (size_t k = 1; k <= 3; ++k) {
+                if (s[i + k] < '0' || s[i + k] > '7') { octal = false; break; }
+                v = v * 8 + (s[i + k] - '0');
+            }
+            if (octal) {
+                out += static_cast<char>(v);
+                i += 3;
+                continue;
+            }
+        }
+        out += s[i];
+    }
+    return out;
+}
+
+// /dev/sdb совпадает с /dev/sdb, /dev/sdb1; /dev/mmcblk0 - с /dev/mmcblk0p1
+bool is_same_disk(const std::string& mounted, const std::string& disk) {
+    if (mounted.compare(0, disk.size(), disk) != 0) return false;
+    size_t i = disk.size();
+    if (i < mounted.size() && mounted[i] == 'p' && isdigit(static_cast<unsigned char>(disk[i - 1]))) ++i;
+    for (; i < mounted.size(); ++i) {
+        if (!isdigit(static_cast<unsigned char>(mounted[i]))) return false;
+    }
+    return true;
+}
+
+void fill_pattern(std::vector<char>& buf, unsigned seed) {
+    // Не нули: часть ФС и контроллеров сжимает или пропускает пустые блоки
+    unsigned x = seed * 2654435761u + 1;
+    for (size_t i = 0; i < buf.size(); ++i) {
+        x = x * 1103515245u + 12345u;
+        buf[i] = static_cast<char>(x >> 16);
+    }
+}
+
+bool write_full(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+std::string file_name(const std::string& dir, const char* prefix, unsigned t, size_t i = 0) {
+    std::ostringstream ss;
+    ss << dir << '/' << prefix << t << '_' << i;
+    return ss.str();
+}
+
+} // namespace
+
+FsBenchmark::FsBenchmark(const FsBenchConfig& config)
+ : config_(config)
+{
+    if (config_.threads == 0) config_.threads = 1;
+    if (config_.small_file_size == 0) config_.small_file_size = 1;
+}
+
+std::string FsBenchmark::findMountPoint(const std::string& block_dev_path) {
+    char resolved[PATH_MAX];
+    std::string disk = realpath(block_dev_path.c_str(), resolved) ? resolved : block_dev_path;
+
+    std::ifstream mounts("/proc/self/mounts");
+    std::string line;
+    while (std::getline(mounts, line)) {
+        std::istringstream fields(line);
+        std::string device, mount_point;
+        if (!(fields >> device >> mount_point)) continue;
+        if (device.compare(0, 5, "/dev/") != 0) continue;
+        std::string dev_resolved = realpath(device.c_str(), resolved) ? resolved : device;
+        if (is_same_disk(dev_resolved, disk)) {
+            return unescape_mount_path(mount_point);
+        }
+    }
+    return "";
+}
+
+std::string FsBenchmark::waitForMountPoint(const std::string& block_dev_path, const std::atomic<bool>* cancel) const {
+    // Автомонтирование происходит уже после события block add
+    for (unsigned i = 0; i <= config_.mount_wait_seconds * 4; ++i) {
+        if (cancel && cancel->load()) break;
+        std::string mount_point = findMountPoint(block_dev_path);
+        if (!mount_point.empty()) return mount_point;
+        if (i < config_.mount_wait_seconds * 4) usleep(250 * 1000);
+    }
+    return "";
+}
+
+template <typename Fn>
+double FsBenchmark::runPhase(Fn fn) {
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < config_.threads; ++t) {
+        workers.push_back(std::thread(fn, t));
+    }
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    return elapsed_us(start) / 1e6;
+}
+
+LatencyStats FsBenchmark::summarize(std::vector<std::vector<double> >& per_thread, double seconds) {
+    std::vector<double> all;
+    for (size_t t = 0; t < per_thread.size(); ++t) {
+        all.insert(all.end(), per_thread[t].begin(), per_thread[t].end());
+    }
+    LatencyStats stats;
+    stats.ops = all.size();
+    if (all.empty()) return stats;
+    std::sort(all.begin(), all.end());
+    auto percentile = [&all](double p) {
+        size_t idx = static_cast<size_t>(p * all.size());
+        return all[std::min(idx, all.size() - 1)];
+    };
+    stats.ops_per_sec = seconds > 0.0 ? all.size() / seconds : 0.0;
+    stats.p50_us = percentile(0.50);
+    stats.p90_us = percentile(0.90);
+    stats.p99_us = percentile(0.99);
+    stats.max_us = all.back();
+    return stats;
+}
+
+void FsBenchmark::printStats(std::ostream& out_stream, const char* name, const LatencyStats& stats) {
+    out_stream << std::fixed << std::setprecision(0);
+    out_stream << "  " << name << ": " << stats.ops_per_sec << " оп/с (" << stats.ops << " оп), задержка p50/p90/p99/max: "
+               << stats.p50_us << "/" << stats.p90_us << "/" << stats.p99_us << "/" << stats.max_us << " мкс\n";
+}
+
+FsBenchResult FsBenchmark::run(const std::string& directory, std::ostream& out_stream,
+                               const std::atomic<bool>* cancel) {
+    FsBenchResult result;
+    result.directory = directory;
+    const unsigned threads = config_.threads;
+
+    out_stream << "\n--- Тест файловой системы: " << directory << " (потоков: " << threads << ") ---\n";
+    syslog(LOG_INFO, "[FsBench] Начало теста файловой системы в %s (потоков: %u)", directory.c_str(), threads);
+
+    std::string tmpl = directory + "/.usb_monitor_bench_XXXXXX";
+    std::vector<char> tmpl_buf(tmpl.begin(), tmpl.end());
+    tmpl_buf.push_back('\0');
+    if (!mkdtemp(tmpl_buf.data())) {
+        result.error = std::string("не удалось создать рабочий каталог: ") + strerror(errno);
+        syslog(LOG_ERR, "[FsBench] %s: %s", directory.c_str(), result.error.c_str());
+        out_stream << "ОШИБКА: " << result.error << "\n";
+        out_stream << "--- Тест файловой системы завершён с ошибкой ---\n";
+        return result;
+    }
+    const std::string work_dir = tmpl_buf.data();
+
+    size_t blocks_per_thread = std::max<size_t>(1, config_.seq_total_mb * 1024 * 1024 / kSeqBlockSize / threads);
+    result.seq_bytes = static_cast<unsigned long long>(blocks_per_thread) * kSeqBlockSize * threads;
+
+    std::vector<std::string> errors(threads);
+    auto fail = [&errors](unsigned t, const std::string& what) {
+        int err = errno;
+        if (errors[t].empty()) errors[t] = what + ": " + strerror(err);
+    };
+    auto cancelled = [&errors, cancel](unsigned t) {
+        if (!cancel || !cancel->load()) return false;
+        if (errors[t].empty()) errors[t] = "отменено";
+        return true;
+    };
+    auto first_error = [&errors]() {
+        for (size_t t = 0; t < errors.size(); ++t) {
+            if (!errors[t].empty()) return errors[t];
+        }
+        return std::string();
+    };
+
+    // Последовательная запись (с fsync - иначе меряется скорость кэша)
+    double seconds = runPhase([&](unsigned t) {
+        std::vector<char> buf(kSeqBlockSize);
+        fill_pattern(buf, t);
+        int fd = open(file_name(work_dir, "seq_", t).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) { fail(t, "создание файла"); return; }
+        for (size_t b = 0; b < blocks_per_thread; ++b) {
+            if (cancelled(t)) break;
+            if (!write_full(fd, buf.data(), buf.size())) { fail(t, "последовательная запись"); break; }
+        }
+        if (errors[t].empty() && fsync(fd) != 0) fail(t, "fsync");
+        close(fd);
+    });
+    std::string error = first_error();
+    if (error.empty()) {
+        result.seq_write_seconds = seconds;
+        result.seq_write_mb_per_sec = seconds > 0.0 ? result.seq_bytes / (1024.0 * 1024.0) / seconds : 0.0;
+
+        // Последовательное чтение: сначала выбрасываем файлы из кэша страниц
+        for (unsigned t = 0; t < threads; ++t) {
+            int fd = open(file_name(work_dir, "seq_", t).c_str(), O_RDONLY);
+            if (fd >= 0) {
+                posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+                close(fd);
+            }
+        }
+        seconds = runPhase([&](unsigned t) {
+            std::vector<char> buf(kSeqBlockSize);
+            int fd = open(file_name(work_dir, "seq_", t).c_str(), O_RDONLY);
+            if (fd < 0) { fail(t, "открытие файла"); return; }
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            ssize_t n;
+            while (!cancelled(t) && (n = read(fd, buf.data(), buf.size())) != 0) {
+                if (n < 0 && errno != EINTR) { fail(t, "последовательное чтение"); break; }
+            }
+            close(fd);
+        });
+        error = first_error();
+        result.seq_read_seconds = seconds;
+        result.seq_read_mb_per_sec = seconds > 0.0 ? result.seq_bytes / (1024.0 * 1024.0) / seconds : 0.0;
+    }
+
+    std::vector<std::vector<double> > latencies(threads);
+    std::vector<size_t> created(threads, 0);
+    if (error.empty()) {
+        // Создание мелких файлов: open + write + close на каждый файл
+        seconds = runPhase([&](unsigned t) {
+            std::vector<char> buf(config_.small_file_size);
+            fill_pattern(buf, t + 100);
+            latencies[t].reserve(config_.small_files);
+            for (size_t i = 0; i < config_.small_files; ++i) {
+                if (cancelled(t)) return;
+                std::string name = file_name(work_dir, "small_", t, i);
+                Clock::time_point start = Clock::now();
+                int fd = open(name.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+                if (fd < 0) { fail(t, "создание мелкого файла"); return; }
+                created[t]++;
+                bool ok = write_full(fd, buf.data(), buf.size());
+                close(fd);
+                if (!ok) { fail(t, "запись мелкого файла"); return; }
+                latencies[t].push_back(elapsed_us(start));
+            }
+        });
+        result.create = summarize(latencies, seconds);
+        error = first_error();
+    }
+
+    if (error.empty()) {
+        // Задержка fsync после небольшой записи - типичный шаблон журналов и БД
+        for (unsigned t = 0; t < threads; ++t) latencies[t].clear();
+        seconds = runPhase([&](unsigned t) {
+            std::vector<char> buf(4096);
+            fill_pattern(buf, t + 200);
+            int fd = open(file_name(work_dir, "fsync_", t).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) { fail(t, "создание файла"); return; }
+            for (unsigned i = 0; i < config_.fsync_ops; ++i) {
+                if (cancelled(t)) break;
+                if (pwrite(fd, buf.data(), buf.size(), static_cast<off_t>(i) * buf.size()) < 0) { fail(t, "запись"); break; }
+                Clock::time_point start = Clock::now();
+                if (fsync(fd) != 0) { fail(t, "fsync"); break; }
+                latencies[t].push_back(elapsed_us(start));
+            }
+            close(fd);
+        });
+        result.fsync = summarize(latencies, seconds);
+        error = first_error();
+    }
+
+    // Удаление мелких файлов выполняется всегда - это и уборка за тестом
+    for (unsigned t = 0; t < threads; ++t) latencies[t].clear();
+    std::vector<std::string> remove_errors(threads);
+    seconds = runPhase([&](unsigned t) {
+        for (size_t i = 0; i < created[t]; ++i) {
+            std::string name = file_name(work_dir, "small_", t, i);
+            Clock::time_point start = Clock::now();
+            if (unlink(name.c_str()) != 0) {
+                if (remove_errors[t].empty()) remove_errors[t] = std::string("удаление мелкого файла: ") + strerror(errno);
+                continue;
+            }
+            latencies[t].push_back(elapsed_us(start));
+        }
+    });
+    result.remove = summarize(latencies, seconds);
+    for (unsigned t = 0; t < threads && error.empty(); ++t) error = remove_errors[t];
+
+    for (unsigned t = 0; t < threads; ++t) {
+        unlink(file_name(work_dir, "seq_", t).c_str());
+        unlink(file_name(work_dir, "fsync_", t).c_str());
+    }
+    if (rmdir(work_dir.c_str()) != 0) {
+        syslog(LOG_WARNING, "[FsBench] Не удалось удалить рабочий каталог %s: %s", work_dir.c_str(), strerror(errno));
+    }
+
+    out_stream << std::fixed << std::setprecision(2);
+    out_stream << "  Последовательная запись: " << result.seq_write_mb_per_sec << " MB/s ("
+               << (result.seq_bytes / (1024.0 * 1024.0)) << " MB)\n";
+    out_stream << "  Последовательное чтение: " << result.seq_read_mb_per_sec << " MB/s\n";
+    std::ostringstream small_name;
+    small_name << "Создание файлов (" << config_.small_file_size << " байт)";
+    printStats(out_stream, small_name.str().c_str(), result.create);
+    printStats(out_stream, "Удаление файлов", result.remove);
+    printStats(out_stream, "fsync", result.fsync);
+
+    if (!error.empty()) {
+        result.error = error;
+        syslog(LOG_ERR, "[FsBench] Тест %s прерван: %s", directory.c_str(), error.c_str());
+        out_stream << "  ОШИБКА: " << error << "\n";
+        out_stream << "--- Тест файловой системы завершён с ошибкой ---\n";
+        return result;
+    }
+
+    result.ok = true;
+    syslog(LOG_INFO, "[FsBench] %s: запись %.2f MB/s, чтение %.2f MB/s, создание %.0f оп/с, удаление %.0f оп/с, fsync p99 %.0f мкс",
+           directory.c_str(), result.seq_write_mb_per_sec, result.seq_read_mb_per_sec,
+           result.create.ops_per_sec, result.remove.ops_per_sec, result.fsync.p99_us);
+    out_stream << "--- Тест файловой системы завершён ---\n";
+    return result;
+}
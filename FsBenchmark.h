@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <atomic>
+#include <cstddef>
+
+struct FsBenchConfig {
+    unsigned threads = 4;               // Рабочие потоки
+    size_t seq_total_mb = 64;           // Объём последовательной записи/чтения на все потоки
+    size_t small_files = 500;           // Мелких файлов на поток
+    size_t small_file_size = 4096;
+    unsigned fsync_ops = 50;            // Замеров fsync на поток
+    unsigned mount_wait_seconds = 5;    // Ожидание автомонтирования обнаруженного накопителя
+};
+
+struct LatencyStats {
+    unsigned long long ops = 0;
+    double ops_per_sec = 0.0;
+    double p50_us = 0.0;
+    double p90_us = 0.0;
+    double p99_us = 0.0;
+    double max_us = 0.0;
+};
+
+struct FsBenchResult {
+    bool ok = false;
+    std::string directory;
+    std::string error;
+    unsigned long long seq_bytes = 0;
+    double seq_write_seconds = 0.0;
+    double seq_read_seconds = 0.0;
+    double seq_write_mb_per_sec = 0.0;
+    double seq_read_mb_per_sec = 0.0;
+    LatencyStats create;
+    LatencyStats remove;
+    LatencyStats fsync;
+};
+
+// Тест на уровне файловой системы: последовательные чтение/запись файлов,
+// создание и удаление мелких файлов, задержка fsync. Работает во временном
+// подкаталоге, который удаляется после теста.
+class FsBenchmark {
+public:
+    explicit FsBenchmark(const FsBenchConfig& config);
+
+    // cancel проверяется перед каждой операцией; уборка файлов выполняется всегда
+    FsBenchResult run(const std::string& directory, std::ostream& out_stream,
+                      const std::atomic<bool>* cancel = nullptr);
+
+    // Точка монтирования блочного устройства или любого его раздела; "" если не смонтировано
+    static std::string findMountPoint(const std::string& block_dev_path);
+    std::string waitForMountPoint(const std::string& block_dev_path, const std::atomic<bool>* cancel = nullptr) const;
+
+private:
+    // Запускает fn(i) в config_.threads потоках, возвращает время фазы в секундах
+    template <typename Fn>
+    double runPhase(Fn fn);
+
+    static LatencyStats summarize(std::vector<std::vector<double> >& per_thread, double seconds);
+    static void printStats(std::ostream& out_stream, const char* name, const LatencyStats& stats);
+
+    FsBenchConfig config_;
+};
@@ -0,0 +1,454 @@
+#include "ImageDuplicator.h"
+#include "DeviceTester.h"
+#include <algorithm>
+#include <chrono>
+#include <syslog.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+namespace {
+
+const size_t kDirectAlign = 4096;   // Выравнивание буферов, смещений и длин для O_DIRECT
+
+double seconds_since(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Узлы от udev открываются без O_CREAT: если накопитель уже извлечён, иначе на devtmpfs
+// появился бы обычный файл на месте узла. O_EXCL не даёт писать на смонтированный диск.
+int open_target(const std::string& path, bool block_device, bool& direct) {
+    int flags = block_device ? (O_WRONLY | O_EXCL) : (O_WRONLY | O_CREAT | O_TRUNC);
+    int fd = open(path.c_str(), flags | O_DIRECT, 0644);
+    if (fd >= 0) {
+        direct = true;
+        return fd;
+    }
+    // tmpfs и некоторые ФС не поддерживают O_DIRECT - пишем через кэш
+    if (errno != EINVAL) {
+        return -1;
+    }
+    direct = false;
+    return open(path.c_str(), flags, 0644);
+}
+
+bool disable_direct(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags & ~O_DIRECT) == 0;
+}
+
+ssize_t read_full(int fd, char* buf, size_t len, off_t offset) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, buf + done, len - done, offset + done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;
+        done += n;
+    }
+    return static_cast<ssize_t>(done);
+}
+
+} // namespace
+
+ImageDuplicator::ImageDuplicator(const DuplicatorConfig& config)
+ : config_(config)
+{
+    // Размер буфера должен быть кратен выравниванию O_DIRECT
+    if (config_.chunk_size < kDirectAlign) config_.chunk_size = kDirectAlign;
+    config_.chunk_size -= config_.chunk_size % kDirectAlign;
+    if (config_.window_chunks < 2) config_.window_chunks = 2;
+}
+
+ImageDuplicator::~ImageDuplicator() {
+    stop();
+    freeSlots();
+}
+
+bool ImageDuplicator::allocateSlots() {
+    if (!slots_.empty()) return true;
+    slots_.resize(config_.window_chunks);
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        void* mem = nullptr;
+        if (posix_memalign(&mem, kDirectAlign, config_.chunk_size) != 0) {
+            syslog(LOG_ERR, "[Duplicator] Не удалось выделить выровненный буфер %zu байт.", config_.chunk_size);
+            freeSlots();
+            return false;
+        }
+        slots_[i].data = static_cast<char*>(mem);
+    }
+    return true;
+}
+
+void ImageDuplicator::freeSlots() {
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        free(slots_[i].data);
+    }
+    slots_.clear();
+}
+
+bool ImageDuplicator::writeChunk(Target& target, const char* data, size_t len, off_t offset) {
+    size_t done = 0;
+    while (done < len) {
+        size_t remaining = len - done;
+        size_t to_write = remaining;
+        if (target.direct) {
+            // Хвост образа, не кратный выравниванию, дописываем уже без O_DIRECT
+            to_write = remaining - remaining % kDirectAlign;
+            if (to_write == 0) {
+                if (!disable_direct(target.fd)) return false;
+                target.direct = false;
+                continue;
+            }
+        }
+        ssize_t n = pwrite(target.fd, data + done, to_write, offset + done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EINVAL && target.direct && disable_direct(target.fd)) {
+                syslog(LOG_WARNING, "[Duplicator] %s не принимает O_DIRECT, продолжаем через кэш.", target.path.c_str());
+                target.direct = false;
+                continue;
+            }
+            return false;
+        }
+        if (n == 0) {
+            errno = ENOSPC;
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+void ImageDuplicator::readerLoop(int src_fd) {
+    unsigned long long seq = 0;
+    off_t offset = 0;
+    for (;;) {
+        Slot& slot = slots_[seq % slots_.size()];
+        {
+            // Ждём, пока самая медленная цель освободит буфер - это и есть обратное давление
+            std::unique_lock<std::mutex> lock(mutex_);
+            released_cv_.wait(lock, [&] { return slot.refs == 0 || alive_targets_ == 0 || abort_.load(); });
+            if (alive_targets_ == 0 || abort_.load()) break;
+        }
+
+        ssize_t n = read_full(src_fd, slot.data, config_.chunk_size, offset);
+        if (n < 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            read_failed_ = true;
+            read_error_ = strerror(errno);
+            syslog(LOG_ERR, "[Duplicator] Ошибка чтения образа %s: %s", config_.image_path.c_str(), read_error_.c_str());
+            break;
+        }
+        if (n == 0) break;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            slot.len = static_cast<size_t>(n);
+            slot.offset = offset;
+            slot.refs = static_cast<int>(alive_targets_);
+            published_ = ++seq;
+        }
+        published_cv_.notify_all();
+        offset += n;
+        if (static_cast<size_t>(n) < config_.chunk_size) break;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        eof_ = true;
+    }
+    published_cv_.notify_all();
+}
+
+void ImageDuplicator::dropTarget(Target& target, unsigned long long next_seq, const std::string& error) {
+    // Вызывается под mutex_: возвращаем в пул все буферы, которые цель уже не запишет
+    for (unsigned long long s = next_seq; s < published_; ++s) {
+        slots_[s % slots_.size()].refs--;
+    }
+    target.alive = false;
+    target.result.error = error;
+    alive_targets_--;
+    released_cv_.notify_all();
+}
+
+void ImageDuplicator::writerLoop(Target& target) {
+    unsigned long long next_seq = 0;
+    for (;;) {
+        Slot* slot = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            published_cv_.wait(lock, [&] { return next_seq < published_ || eof_ || read_failed_ || abort_.load(); });
+            if (read_failed_ || abort_.load()) {
+                dropTarget(target, next_seq, read_failed_ ? "ошибка чтения образа: " + read_error_ : "прервано");
+                return;
+            }
+            if (next_seq >= published_) break;
+            slot = &slots_[next_seq % slots_.size()];
+        }
+
+        // Буфер не меняется, пока его refs > 0, поэтому пишем без блокировки
+        bool ok = writeChunk(target, slot->data, slot->len, slot->offset);
+        std::string error = ok ? std::string() : std::string(strerror(errno));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!ok) {
+            syslog(LOG_ERR, "[Duplicator] Ошибка записи на %s (смещение %lld): %s",
+                   target.path.c_str(), static_cast<long long>(slot->offset), error.c_str());
+            dropTarget(target, next_seq, error);
+            return;
+        }
+        target.result.bytes_written += slot->len;
+        if (--slot->refs == 0) {
+            released_cv_.notify_all();
+        }
+        ++next_seq;
+    }
+
+    if (fsync(target.fd) != 0 && errno != EINVAL) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        target.alive = false;
+        target.result.error = std::string("fsync: ") + strerror(errno);
+        return;
+    }
+    target.result.write_ok = true;
+}
+
+void ImageDuplicator::verifyTarget(Target& target) {
+    target.result.verified = true;
+
+    int src_fd = open(config_.image_path.c_str(), O_RDONLY);
+    bool direct = true;
+    int dst_fd = open(target.path.c_str(), O_RDONLY | O_DIRECT);
+    if (dst_fd < 0 && errno == EINVAL) {
+        direct = false;
+        dst_fd = open(target.path.c_str(), O_RDONLY);
+    }
+    if (src_fd < 0 || dst_fd < 0) {
+        target.result.error = std::string("проверка: ") + strerror(errno);
+        if (src_fd >= 0) close(src_fd);
+        if (dst_fd >= 0) close(dst_fd);
+        return;
+    }
+    if (!direct) {
+        // Без O_DIRECT хотя бы сбрасываем кэш, чтобы читать с носителя
+        posix_fadvise(dst_fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+
+    void* src_mem = nullptr;
+    void* dst_mem = nullptr;
+    if (posix_memalign(&src_mem, kDirectAlign, config_.chunk_size) != 0 ||
+        posix_memalign(&dst_mem, kDirectAlign, config_.chunk_size) != 0) {
+        target.result.error = "проверка: нет памяти для буферов";
+        free(src_mem);
+        close(src_fd);
+        close(dst_fd);
+        return;
+    }
+    char* src_buf = static_cast<char*>(src_mem);
+    char* dst_buf = static_cast<char*>(dst_mem);
+
+    bool ok = true;
+    off_t offset = 0;
+    while (ok && !abort_.load()) {
+        ssize_t n = read_full(src_fd, src_buf, config_.chunk_size, offset);
+        if (n <= 0) {
+            if (n < 0) { ok = false; target.result.error = std::string("проверка, чтение образа: ") + strerror(errno); }
+            break;
+        }
+        // При O_DIRECT читаем кратно выравниванию, сравниваем только длину образа
+        size_t want = static_cast<size_t>(n);
+        if (direct) want = std::min(config_.chunk_size, (want + kDirectAlign - 1) / kDirectAlign * kDirectAlign);
+        ssize_t m = read_full(dst_fd, dst_buf, want, offset);
+        if (m < n) {
+            ok = false;
+            target.result.error = m < 0 ? std::string("проверка, чтение цели: ") + strerror(errno)
+                                        : std::string("проверка: цель короче образа");
+            break;
+        }
+        if (!DeviceTester::check_data_integrity(src_buf, dst_buf, static_cast<size_t>(n))) {
+            ok = false;
+            target.result.error = "проверка: данные не совпадают со смещения " + std::to_string(static_cast<long long>(offset));
+            break;
+        }
+        offset += n;
+    }
+    target.result.verify_ok = ok && !abort_.load();
+
+    free(src_mem);
+    free(dst_mem);
+    close(src_fd);
+    close(dst_fd);
+}
+
+std::vector<DuplicationResult> ImageDuplicator::duplicate(const std::vector<std::string>& targets) {
+    return runPass(targets, false);
+}
+
+std::vector<DuplicationResult> ImageDuplicator::runPass(const std::vector<std::string>& targets, bool block_devices) {
+    std::vector<DuplicationResult> results;
+    if (targets.empty()) return results;
+
+    std::deque<Target> active;   // deque: адреса элементов стабильны для потоков
+    for (size_t i = 0; i < targets.size(); ++i) {
+        Target t;
+        t.path = targets[i];
+        t.result.target = targets[i];
+        t.fd = open_target(t.path, block_devices, t.direct);
+        if (t.fd < 0) {
+            t.alive = false;
+            t.result.error = strerror(errno);
+            syslog(LOG_ERR, "[Duplicator] Не удалось открыть цель %s: %s", t.path.c_str(), t.result.error.c_str());
+        }
+        active.push_back(t);
+    }
+
+    int src_fd = open(config_.image_path.c_str(), O_RDONLY);
+    if (src_fd < 0 || !allocateSlots()) {
+        std::string error = src_fd < 0 ? std::string("образ: ") + strerror(errno) : "нет памяти для буферов";
+        syslog(LOG_ERR, "[Duplicator] Проход отменён: %s", error.c_str());
+        for (size_t i = 0; i < active.size(); ++i) {
+            if (active[i].fd >= 0) close(active[i].fd);
+            if (active[i].alive) active[i].result.error = error;
+            if (result_callback_) {
+                result_callback_(active[i].result);
+            }
+            results.push_back(active[i].result);
+        }
+        if (src_fd >= 0) close(src_fd);
+        return results;
+    }
+    posix_fadvise(src_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        published_ = 0;
+        eof_ = false;
+        read_failed_ = false;
+        read_error_.clear();
+        alive_targets_ = 0;
+        for (size_t i = 0; i < slots_.size(); ++i) slots_[i].refs = 0;
+        for (size_t i = 0; i < active.size(); ++i) {
+            if (active[i].alive) alive_targets_++;
+        }
+    }
+
+    syslog(LOG_INFO, "[Duplicator] Запись %s на %zu целей (буфер %zu КБ, окно %zu).",
+           config_.image_path.c_str(), alive_targets_, config_.chunk_size / 1024, slots_.size());
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> writers;
+    std::vector<double> finished(active.size(), 0.0);
+    for (size_t i = 0; i < active.size(); ++i) {
+        if (!active[i].alive) continue;
+        writers.push_back(std::thread([this, &active, &finished, &start, i] {
+            writerLoop(active[i]);
+            finished[i] = seconds_since(start);
+            if (config_.verify && active[i].result.write_ok) {
+                verifyTarget(active[i]);
+            }
+        }));
+    }
+
+    readerLoop(src_fd);
+    for (size_t i = 0; i < writers.size(); ++i) {
+        writers[i].join();
+    }
+    close(src_fd);
+
+    for (size_t i = 0; i < active.size(); ++i) {
+        Target& t = active[i];
+        if (t.fd >= 0) close(t.fd);
+        t.result.seconds = finished[i];
+        double mb = t.result.bytes_written / (1024.0 * 1024.0);
+        if (t.result.write_ok) {
+            syslog(LOG_INFO, "[Duplicator] %s: записано %.2f MB за %.2f сек (%.2f MB/s)%s",
+                   t.path.c_str(), mb, t.result.seconds, t.result.seconds > 0.0001 ? mb / t.result.seconds : 0.0,
+                   !t.result.verified ? "" : (t.result.verify_ok ? ", проверка пройдена" : ", ПРОВЕРКА НЕ ПРОЙДЕНА"));
+        } else {
+            syslog(LOG_ERR, "[Duplicator] %s: запись не удалась: %s", t.path.c_str(), t.result.error.c_str());
+        }
+        if (result_callback_) {
+            result_callback_(t.result);
+        }
+        results.push_back(t.result);
+    }
+    return results;
+}
+
+bool ImageDuplicator::start() {
+    if (batch_running_) return true;
+    if (access(config_.image_path.c_str(), R_OK) != 0) {
+        syslog(LOG_ERR, "[Duplicator] Образ %s недоступен: %s", config_.image_path.c_str(), strerror(errno));
+        return false;
+    }
+    abort_.store(false);
+    batch_running_ = true;
+    batch_thread_ = std::thread(&ImageDuplicator::batchLoop, this);
+    syslog(LOG_INFO, "[Duplicator] Авто-режим: образ %s будет записан на подключаемые накопители.", config_.image_path.c_str());
+    return true;
+}
+
+void ImageDuplicator::addTarget(const std::string& target_path) {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        if (std::find(pending_.begin(), pending_.end(), target_path) != pending_.end()) return;
+        pending_.push_back(target_path);
+    }
+    syslog(LOG_INFO, "[Duplicator] Цель %s поставлена в очередь.", target_path.c_str());
+    pending_cv_.notify_all();
+}
+
+void ImageDuplicator::removeTarget(const std::string& target_path) {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    auto it = std::find(pending_.begin(), pending_.end(), target_path);
+    if (it == pending_.end()) return;
+    pending_.erase(it);
+    syslog(LOG_INFO, "[Duplicator] Цель %s извлечена до начала записи, удалена из очереди.", target_path.c_str());
+}
+
+void ImageDuplicator::stop() {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        if (!batch_running_) return;
+        batch_running_ = false;
+    }
+    {
+        // Под mutex_, чтобы потоки прохода не пропустили пробуждение
+        std::lock_guard<std::mutex> lock(mutex_);
+        abort_.store(true);
+    }
+    pending_cv_.notify_all();
+    published_cv_.notify_all();
+    released_cv_.notify_all();
+    if (batch_thread_.joinable()) {
+        batch_thread_.join();
+    }
+}
+
+void ImageDuplicator::batchLoop() {
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    while (batch_running_) {
+        pending_cv_.wait(lock, [this] { return !pending_.empty() || !batch_running_; });
+        if (!batch_running_) break;
+
+        // Собираем партию: ждём, пока новые накопители перестанут появляться
+        size_t seen = 0;
+        while (batch_running_ && seen != pending_.size()) {
+            seen = pending_.size();
+            pending_cv_.wait_for(lock, std::chrono::seconds(config_.settle_seconds),
+                                 [this, seen] { return pending_.size() != seen || !batch_running_; });
+        }
+        if (!batch_running_) break;
+
+        std::vector<std::string> batch(pending_.begin(), pending_.end());
+        pending_.clear();
+        lock.unlock();
+        runPass(batch, true);
+        lock.lock();
+    }
+}
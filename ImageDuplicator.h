@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+
+struct DuplicatorConfig {
+    std::string image_path;              // Эталонный образ
+    bool verify = false;                 // Проверка записанных данных после записи
+    size_t chunk_size = 1024 * 1024;     // Размер одного буфера (кратен выравниванию)
+    size_t window_chunks = 16;           // Число буферов в пуле (окно отставания самой медленной цели)
+    unsigned settle_seconds = 5;         // Ожидание новых целей перед стартом прохода (авто-режим)
+};
+
+struct DuplicationResult {
+    std::string target;
+    bool write_ok = false;
+    bool verified = false;
+    bool verify_ok = false;
+    unsigned long long bytes_written = 0;
+    double seconds = 0.0;
+    std::string error;
+
+    bool ok() const { return write_ok && (!verified || verify_ok); }
+};
+
+// Запись одного образа на много устройств: источник читается один раз в пул
+// выровненных буферов, каждый буфер раздаётся всем целям без копирования.
+class ImageDuplicator {
+public:
+    using ResultCallback = std::function<void(const DuplicationResult& result)>;
+
+    explicit ImageDuplicator(const DuplicatorConfig& config);
+    ~ImageDuplicator();
+
+    // Синхронный проход по заданному списку целей (файлы, loop-устройства, диски).
+    // Отсутствующие файлы создаются.
+    std::vector<DuplicationResult> duplicate(const std::vector<std::string>& targets);
+
+    // Авто-режим: цели добавляются по мере обнаружения накопителей.
+    bool start();
+    // Цели авто-режима - узлы блочных устройств: открываются с O_EXCL и без O_CREAT
+    void addTarget(const std::string& target_path);
+    // Накопитель извлечён до начала прохода
+    void removeTarget(const std::string& target_path);
+    void stop();
+
+    // Вызывается для каждой цели по завершении прохода (из потока прохода)
+    void setResultCallback(ResultCallback callback) { result_callback_ = callback; }
+
+    const DuplicatorConfig& config() const { return config_; }
+
+private:
+    struct Slot {
+        char* data = nullptr;
+        size_t len = 0;
+        off_t offset = 0;
+        int refs = 0;        // Сколько целей ещё не записали этот буфер
+    };
+
+    struct Target {
+        std::string path;
+        int fd = -1;
+        bool direct = false;
+        bool alive = true;
+        DuplicationResult result;
+    };
+
+    std::vector<DuplicationResult> runPass(const std::vector<std::string>& targets, bool block_devices);
+    bool allocateSlots();
+    void freeSlots();
+    void readerLoop(int src_fd);
+    void writerLoop(Target& target);
+    void dropTarget(Target& target, unsigned long long next_seq, const std::string& error);
+    void verifyTarget(Target& target);
+    void batchLoop();
+
+    static bool writeChunk(Target& target, const char* data, size_t len, off_t offset);
+
+    DuplicatorConfig config_;
+    ResultCallback result_callback_;
+
+    // Состояние текущего прохода
+    std::mutex mutex_;
+    std::condition_variable published_cv_;   // Появился новый буфер / конец потока
+    std::condition_variable released_cv_;    // Буфер освобождён всеми целями
+    std::vector<Slot> slots_;
+    unsigned long long published_ = 0;
+    size_t alive_targets_ = 0;
+    bool eof_ = false;
+    bool read_failed_ = false;
+    std::string read_error_;
+    std::atomic<bool> abort_{false};
+
+    // Авто-режим
+    std::mutex pending_mutex_;
+    std::condition_variable pending_cv_;
+    std::deque<std::string> pending_;
+    std::thread batch_thread_;
+    bool batch_running_ = false;
+};
@@ -10,14 +10,181 @@
 #include <cstring>
 #include <cerrno>
 #include <sys/wait.h>
+#include <spawn.h>
 #include <streambuf>
+#include <thread>
+
+std::vector<std::unique_ptr<ResultSink>> ResultDisplay::sinks_;
+bool ResultDisplay::gui_enabled_ = true;
+bool ResultDisplay::fs_bench_enabled_ = false;
+FsBenchConfig ResultDisplay::fs_bench_config_;
+ResultDisplay::CachedResult ResultDisplay::cache_[ResultDisplay::kResultCacheSize];
+size_t ResultDisplay::cache_next_ = 0;
+size_t ResultDisplay::cache_count_ = 0;
+std::mutex ResultDisplay::cache_mutex_;
 
 ResultDisplay::file_buf::file_buf(FILE* f) : fp(f) {}
 int ResultDisplay::file_buf::overflow(int c) { return fputc(c, fp) == EOF ? EOF : c; }
 int ResultDisplay::file_buf::sync() { return fflush(fp) == 0 ? 0 : -1; }
 
 
-void ResultDisplay::prepareAndDisplay(const DeviceInfo& info, bool is_storage_device) {
+bool ResultDisplay::addSink(const std::string& spec) {
+    ResultSink* sink = ResultSink::open(spec);
+    if (!sink) return false;
+    sinks_.push_back(std::unique_ptr<ResultSink>(sink));
+    return true;
+}
+
+void ResultDisplay::closeSinks() {
+    sinks_.clear();
+}
+
+void ResultDisplay::setGuiEnabled(bool enabled) {
+    gui_enabled_ = enabled;
+}
+
+void ResultDisplay::publish(const ResultRecord& record) {
+    for (size_t i = 0; i < sinks_.size(); ++i) {
+        sinks_[i]->write(record);
+    }
+
+    // Кэш для управляющего сокета: кольцо готовых строк JSON, без выделения памяти
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    CachedResult& slot = cache_[cache_next_];
+    snprintf(slot.devpath, sizeof(slot.devpath), "%s", record.device ? record.device->devpath.c_str() : "");
+    snprintf(slot.target, sizeof(slot.target), "%s", record.target);
+    slot.len = ResultSink::format(ResultSink::Format::JsonLines, record, slot.line);
+    cache_next_ = (cache_next_ + 1) % kResultCacheSize;
+    if (cache_count_ < kResultCacheSize) cache_count_++;
+}
+
+std::vector<std::string> ResultDisplay::recentResults(const std::string& devpath, const std::string& target,
+                                                     size_t limit) {
+    std::vector<std::string> out;
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    for (size_t i = 0; i < cache_count_ && out.size() < limit; ++i) {
+        const CachedResult& slot = cache_[(cache_next_ + kResultCacheSize - 1 - i) % kResultCacheSize];
+        bool all = devpath.empty() && target.empty();
+        if (all || (!devpath.empty() && devpath == slot.devpath) || (!target.empty() && target == slot.target)) {
+            out.push_back(std::string(slot.line, slot.len));
+        }
+    }
+    return std::vector<std::string>(out.rbegin(), out.rend());
+}
+
+void ResultDisplay::publishDeviceResult(const DeviceInfo& info, bool is_storage_device, const ReadTestResult& read_result) {
+    ResultRecord record;
+    record.kind = is_storage_device ? "read_test" : "device_info";
+    record.device = &info;
+    record.target = info.block_device.c_str();
+    record.is_storage = is_storage_device;
+    record.ok = is_storage_device ? read_result.ok : true;
+    record.bytes = read_result.bytes_read;
+    record.seconds = read_result.seconds;
+    record.mb_per_sec = read_result.mb_per_sec;
+    record.error = read_result.error.c_str();
+    publish(record);
+}
+
+void ResultDisplay::enableFsBenchmark(const FsBenchConfig& config) {
+    fs_bench_enabled_ = true;
+    fs_bench_config_ = config;
+}
+
+void ResultDisplay::publishDuplicationResult(const DuplicationResult& result) {
+    ResultRecord record;
+    record.kind = "duplicate";
+    record.target = result.target.c_str();
+    record.is_storage = true;
+    record.ok = result.ok();
+    record.bytes = result.bytes_written;
+    record.seconds = result.seconds;
+    record.mb_per_sec = result.seconds > 0.0001 ? result.bytes_written / (1024.0 * 1024.0) / result.seconds : 0.0;
+    record.error = result.error.c_str();
+    publish(record);
+}
+
+void ResultDisplay::publishFsBenchResult(const DeviceInfo* info, const FsBenchResult& result) {
+    ResultRecord record;
+    record.device = info;
+    record.target = result.directory.c_str();
+    record.is_storage = true;
+    record.ok = result.ok;
+    record.error = result.error.c_str();
+
+    record.kind = "fs_seq_write";
+    record.bytes = result.seq_bytes;
+    record.seconds = result.seq_write_seconds;
+    record.mb_per_sec = result.seq_write_mb_per_sec;
+    publish(record);
+    record.kind = "fs_seq_read";
+    record.seconds = result.seq_read_seconds;
+    record.mb_per_sec = result.seq_read_mb_per_sec;
+    publish(record);
+
+    record.bytes = 0;
+    record.seconds = 0.0;
+    record.mb_per_sec = 0.0;
+    const struct { const char* kind; const LatencyStats* stats; } ops[] = {
+        {"fs_create", &result.create}, {"fs_delete", &result.remove}, {"fs_fsync", &result.fsync}
+    };
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); ++i) {
+        record.kind = ops[i].kind;
+        record.ops = ops[i].stats->ops;
+        record.ops_per_sec = ops[i].stats->ops_per_sec;
+        record.p50_us = ops[i].stats->p50_us;
+        record.p90_us = ops[i].stats->p90_us;
+        record.p99_us = ops[i].stats->p99_us;
+        record.max_us = ops[i].stats->max_us;
+        publish(record);
+    }
+}
+
+void ResultDisplay::runFsBenchmark(const DeviceInfo& info, std::ostream& out_stream, const std::atomic<bool>* cancel) {
+    FsBenchmark bench(fs_bench_config_);
+    std::string mount_point = bench.waitForMountPoint(info.block_device, cancel);
+    if (mount_point.empty()) {
+        syslog(LOG_INFO, "[Display] %s не смонтировано, тест файловой системы пропущен.", info.block_device.c_str());
+        out_stream << "\nТест файловой системы не выполнялся (устройство " << info.block_device << " не смонтировано).\n";
+        return;
+    }
+    FsBenchResult result = bench.run(mount_point, out_stream, cancel);
+    publishFsBenchResult(&info, result);
+}
+
+// Возвращает false, если тесты были отменены
+bool ResultDisplay::runTests(const DeviceInfo& info, bool is_storage_device, TestProfile profile,
+                             const std::atomic<bool>* cancel, std::ostream& out_stream) {
+    ReadTestResult read_result;
+    if (!is_storage_device) {
+        publishDeviceResult(info, is_storage_device, read_result);
+        return true;
+    }
+
+    bool run_read = profile != TestProfile::FsBench;
+    bool run_fs = profile == TestProfile::FsBench || profile == TestProfile::Full ||
+                  (profile == TestProfile::Default && fs_bench_enabled_);
+    if (run_read) {
+        syslog(LOG_INFO, "[Display] Устройство %s является накопителем. Запуск теста ЧТЕНИЯ.", info.devpath.c_str());
+        DeviceTester tester;
+        read_result = tester.perform_tests_read_only(info.block_device, out_stream, cancel);
+        publishDeviceResult(info, is_storage_device, read_result);
+    }
+    if (run_fs && !(cancel && cancel->load())) {
+        runFsBenchmark(info, out_stream, cancel);
+    }
+    return !(cancel && cancel->load());
+}
+
+void ResultDisplay::prepareAndDisplay(const DeviceInfo& info, bool is_storage_device,
+                                      TestProfile profile, const std::atomic<bool>* cancel) {
+    if (!gui_enabled_) {
+        // Без окна текстовый отчёт не нужен: только тесты и потоковый вывод
+        std::ostream null_stream(nullptr);
+        runTests(info, is_storage_device, profile, cancel, null_stream);
+        return;
+    }
+
     char log_filename_template[] = "/var/tmp/usb_monitor_XXXXXX";
     int fd = mkstemp(log_filename_template);
 
@@ -44,32 +211,47 @@ void ResultDisplay::prepareAndDisplay(const DeviceInfo& info, bool is_storage_de
 
     struct file_buf log_streambuf(log_file_c);
     std::ostream log_ostream(&log_streambuf);
-    DeviceTester tester;
 
-    if (is_storage_device) {
-        syslog(LOG_INFO, "[Display] Устройство %s является накопителем. Запуск теста ЧТЕНИЯ.", info.devpath.c_str());
-        // *** ВЫЗЫВАЕМ ТЕСТ ТОЛЬКО ЧТЕНИЯ ***
-        tester.perform_tests_read_only(info.block_device, log_ostream);
-    } else {
+    if (!is_storage_device) {
         syslog(LOG_INFO, "[Display] Устройство %s не является накопителем. Тесты не выполняются.", info.devpath.c_str());
         fprintf(log_file_c, "\nТесты производительности не выполнялись (устройство не является накопителем).\n");
     }
+    bool completed = runTests(info, is_storage_device, profile, cancel, log_ostream);
+    log_ostream.flush();
 
     fclose(log_file_c);
     syslog(LOG_INFO, "[Display] Информация и результаты для %s сохранены в %s.", info.devpath.c_str(), log_filename_template);
 
+    if (!completed) {
+        syslog(LOG_INFO, "[Display] Тесты %s отменены, окно с результатами не показывается.", info.devpath.c_str());
+        unlink(log_filename_template);
+        return;
+    }
+
+    // Окно показывается в отдельном потоке: задание теста (и его отмена,
+    // повторный запуск, остановка демона) не ждут, пока пользователь закроет окно
+    std::string device_label = info.product_name.empty() ? (info.vendor_id + ":" + info.product_id) : info.product_name;
+    std::thread(&ResultDisplay::showResultsWindow, std::string(log_filename_template), device_label).detach();
+}
+
+void ResultDisplay::showResultsWindow(std::string log_filename, std::string device_label) {
     // ... (код вызова zenity и unlink без изменений) ...
     std::string command = "zenity --text-info --title=\"Информация об USB: ";
-    std::string device_label = info.product_name.empty() ? (info.vendor_id + ":" + info.product_id) : info.product_name;
     size_t pos = 0;
     while ((pos = device_label.find('"', pos)) != std::string::npos) { device_label.replace(pos, 1, "\\\""); pos += 2; }
     command += device_label;
     command += "\" --filename='";
-    command += log_filename_template;
+    command += log_filename;
     command += "' --width=800 --height=600";
 
     syslog(LOG_INFO, "[Display] ПОПЫТКА ВЫПОЛНЕНИЯ КОМАНДЫ: %s", command.c_str());
-    int ret = system(command.c_str());
+    // Не system(): он игнорирует SIGINT/SIGQUIT во всём процессе, пока окно открыто
+    int ret = -1;
+    pid_t pid;
+    char* const argv[] = { const_cast<char*>("sh"), const_cast<char*>("-c"), const_cast<char*>(command.c_str()), nullptr };
+    if (posix_spawn(&pid, "/bin/sh", nullptr, nullptr, argv, environ) == 0) {
+        while (waitpid(pid, &ret, 0) < 0 && errno == EINTR) {}
+    }
     syslog(LOG_INFO, "[Display] КОМАНДА ЗАВЕРШЕНА. Код возврата system(): %d", ret);
     int exit_status = -1;
     if (WIFEXITED(ret)) { exit_status = WEXITSTATUS(ret); }
@@ -78,8 +260,8 @@ void ResultDisplay::prepareAndDisplay(const DeviceInfo& info, bool is_storage_de
     else {
          if (exit_status == 127) { syslog(LOG_WARNING, "[Display] Команда zenity не найдена (exit status 127). Установите пакет 'zenity'."); }
          else { syslog(LOG_WARNING, "[Display] Команда zenity завершилась с ошибкой (system ret: %d, exit status: %d).", ret, exit_status); }
-         syslog(LOG_INFO, "[Display] Окно с результатами не показано или закрыто с ошибкой. Информация доступна в %s", log_filename_template);
+         syslog(LOG_INFO, "[Display] Окно с результатами не показано или закрыто с ошибкой. Информация доступна в %s", log_filename.c_str());
      }
-    unlink(log_filename_template);
-    syslog(LOG_DEBUG, "[Display] Временный файл %s удален.", log_filename_template);
+    unlink(log_filename.c_str());
+    syslog(LOG_DEBUG, "[Display] Временный файл %s удален.", log_filename.c_str());
 }
\ No newline at end of file
@@ -1,15 +1,69 @@
 #pragma once
 
 #include "DeviceInfo.h"
+#include "DeviceTester.h"
+#include "ResultSink.h"
+#include "FsBenchmark.h"
+#include "ImageDuplicator.h"
 #include <string>
 #include <map>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <atomic>
 #include <streambuf> 
 
+// Набор тестов накопителя. Default - тест чтения и, если включен (-F), тест ФС.
+enum class TestProfile { Default, Read, FsBench, Full };
+
 class ResultDisplay {
 public:
-    static void prepareAndDisplay(const DeviceInfo& info, bool is_storage_device);
+    static void prepareAndDisplay(const DeviceInfo& info, bool is_storage_device,
+                                  TestProfile profile = TestProfile::Default,
+                                  const std::atomic<bool>* cancel = nullptr);
+
+    // Потоковый вывод результатов (JSON Lines / CSV) для машин без дисплея
+    static bool addSink(const std::string& spec);
+    static void closeSinks();
+    static void setGuiEnabled(bool enabled);
+    static void publish(const ResultRecord& record);
+
+    // Тест файловой системы смонтированного накопителя после теста чтения
+    static void enableFsBenchmark(const FsBenchConfig& config);
+    static void publishFsBenchResult(const DeviceInfo* info, const FsBenchResult& result);
+    static void publishDuplicationResult(const DuplicationResult& result);
+
+    // Последние опубликованные результаты в JSON Lines, новые в конце.
+    // Запись подходит, если совпал devpath или цель (блочное устройство); оба пустые - все.
+    static std::vector<std::string> recentResults(const std::string& devpath, const std::string& target,
+                                                  size_t limit);
 
 private:
+    static const size_t kResultCacheSize = 128;
+
+    struct CachedResult {
+        char devpath[256];
+        char target[256];
+        char line[ResultSink::kRecordSize];
+        size_t len = 0;
+    };
+
+    static bool runTests(const DeviceInfo& info, bool is_storage_device, TestProfile profile,
+                         const std::atomic<bool>* cancel, std::ostream& out_stream);
+    static void publishDeviceResult(const DeviceInfo& info, bool is_storage_device, const ReadTestResult& read_result);
+    // Окно zenity с отчётом; удаляет файл отчёта после закрытия
+    static void showResultsWindow(std::string log_filename, std::string device_label);
+    static void runFsBenchmark(const DeviceInfo& info, std::ostream& out_stream, const std::atomic<bool>* cancel);
+
+    static std::vector<std::unique_ptr<ResultSink>> sinks_;
+    static bool gui_enabled_;
+    static bool fs_bench_enabled_;
+    static FsBenchConfig fs_bench_config_;
+    static CachedResult cache_[kResultCacheSize];
+    static size_t cache_next_;
+    static size_t cache_count_;
+    static std::mutex cache_mutex_;
+
     struct file_buf : std::streambuf {
         FILE* fp;
         file_buf(FILE* f);
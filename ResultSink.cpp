@@ -0,0 +1,365 @@
+#include "ResultSink.h"
+#include <chrono>
+#include <syslog.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+namespace {
+
+// Сколько ждать остальные записи пачки перед write()
+const std::chrono::milliseconds kLinger(50);
+
+const char* kCsvHeader =
+    "ts_ms,kind,devpath,vendor_id,product_id,manufacturer,product,target,capacity_gb,"
+    "is_storage,ok,bytes,seconds,mb_per_sec,ops,ops_per_sec,p50_us,p90_us,p99_us,max_us,error\n";
+
+const size_t kFieldSize = 256;
+
+// Сериализация в чужой буфер без выделения памяти. Строковые поля отсекаются
+// по kFieldSize, поэтому запись всегда помещается в ResultSink::kRecordSize.
+struct RecordWriter {
+    char* buf;
+    size_t len;
+
+    RecordWriter(char* b, size_t l) : buf(b), len(l) {}
+
+    void put(const char* s, size_t n);
+    void put(const char* s);
+    void putJsonString(const char* s);
+    void putCsvField(const char* s);
+    void putNumber(const char* buf, int n, size_t size);
+    void putUInt(unsigned long long v);
+    void putDouble(double v);
+    void trimIncompleteUtf8(size_t field_start);
+    void record(ResultSink::Format format, const ResultRecord& r);
+};
+
+void RecordWriter::put(const char* s, size_t n) {
+    memcpy(buf + len, s, n);
+    len += n;
+}
+
+void RecordWriter::put(const char* s) {
+    put(s, strlen(s));
+}
+
+void RecordWriter::trimIncompleteUtf8(size_t field_start) {
+    // Отсечение могло разрезать многобайтный символ - убираем его целиком
+    size_t lead = len;
+    while (lead > field_start && (static_cast<unsigned char>(buf[lead - 1]) & 0xC0) == 0x80) --lead;
+    if (lead == field_start) return;
+    unsigned char c = static_cast<unsigned char>(buf[lead - 1]);
+    if (c < 0xC0) return;
+    size_t expected = c >= 0xF0 ? 4 : (c >= 0xE0 ? 3 : 2);
+    if (len - (lead - 1) < expected) {
+        len = lead - 1;
+    }
+}
+
+void RecordWriter::putJsonString(const char* s) {
+    put("\"", 1);
+    size_t field_start = len;
+    size_t budget = kFieldSize;
+    for (; *s; ++s) {
+        unsigned char c = static_cast<unsigned char>(*s);
+        char esc[8];
+        const char* out = esc;
+        size_t n = 2;
+        switch (c) {
+            case '"':  out = "\\\""; break;
+            case '\\': out = "\\\\"; break;
+            case '\n': out = "\\n"; break;
+            case '\r': out = "\\r"; break;
+            case '\t': out = "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    n = snprintf(esc, sizeof(esc), "\\u%04x", c);
+                } else {
+                    out = s;
+                    n = 1;
+                }
+        }
+        if (n > budget) {
+            trimIncompleteUtf8(field_start);
+            break;
+        }
+        put(out, n);
+        budget -= n;
+    }
+    put("\"", 1);
+}
+
+void RecordWriter::putCsvField(const char* s) {
+    // CR/LF заменяются пробелом: запись CSV всегда одна строка, по '\n' режется и
+    // считается вывод в FIFO
+    bool quote = strpbrk(s, ",\"") != nullptr;
+    if (quote) put("\"", 1);
+    size_t field_start = len;
+    size_t budget = kFieldSize;
+    for (; *s; ++s) {
+        size_t n = *s == '"' ? 2 : 1;
+        if (n > budget) {
+            trimIncompleteUtf8(field_start);
+            break;
+        }
+        if (*s == '"') put("\"", 1);
+        put(*s == '\n' || *s == '\r' ? " " : s, 1);
+        budget -= n;
+    }
+    if (quote) put("\"", 1);
+}
+
+void RecordWriter::putNumber(const char* buf, int n, size_t size) {
+    // snprintf возвращает длину без усечения - не читаем за пределами buf
+    if (n < 0) n = 0;
+    if (static_cast<size_t>(n) >= size) n = static_cast<int>(size - 1);
+    put(buf, n);
+}
+
+void RecordWriter::putUInt(unsigned long long v) {
+    char buf[24];
+    putNumber(buf, snprintf(buf, sizeof(buf), "%llu", v), sizeof(buf));
+}
+
+void RecordWriter::putDouble(double v) {
+    char buf[32];
+    putNumber(buf, snprintf(buf, sizeof(buf), "%.3f", v), sizeof(buf));
+}
+
+void RecordWriter::record(ResultSink::Format format, const ResultRecord& r) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    unsigned long long ts_ms = static_cast<unsigned long long>(ts.tv_sec) * 1000ULL + ts.tv_nsec / 1000000;
+
+    const DeviceInfo* d = r.device;
+    const char* devpath = d ? d->devpath.c_str() : "";
+    const char* vendor_id = d ? d->vendor_id.c_str() : "";
+    const char* product_id = d ? d->product_id.c_str() : "";
+    const char* manufacturer = d ? d->manufacturer.c_str() : "";
+    const char* product = d ? d->product_name.c_str() : "";
+    const char* capacity = d ? d->capacity_gb.c_str() : "";
+
+    if (format == ResultSink::Format::JsonLines) {
+        put("{\"ts_ms\":"); putUInt(ts_ms);
+        put(",\"kind\":"); putJsonString(r.kind);
+        put(",\"devpath\":"); putJsonString(devpath);
+        put(",\"vendor_id\":"); putJsonString(vendor_id);
+        put(",\"product_id\":"); putJsonString(product_id);
+        put(",\"manufacturer\":"); putJsonString(manufacturer);
+        put(",\"product\":"); putJsonString(product);
+        put(",\"target\":"); putJsonString(r.target);
+        put(",\"capacity_gb\":"); putJsonString(capacity);
+        put(",\"is_storage\":"); put(r.is_storage ? "true" : "false");
+        put(",\"ok\":"); put(r.ok ? "true" : "false");
+        put(",\"bytes\":"); putUInt(r.bytes);
+        put(",\"seconds\":"); putDouble(r.seconds);
+        put(",\"mb_per_sec\":"); putDouble(r.mb_per_sec);
+        put(",\"ops\":"); putUInt(r.ops);
+        put(",\"ops_per_sec\":"); putDouble(r.ops_per_sec);
+        put(",\"p50_us\":"); putDouble(r.p50_us);
+        put(",\"p90_us\":"); putDouble(r.p90_us);
+        put(",\"p99_us\":"); putDouble(r.p99_us);
+        put(",\"max_us\":"); putDouble(r.max_us);
+        put(",\"error\":"); putJsonString(r.error);
+        put("}\n", 2);
+    } else {
+        putUInt(ts_ms); put(",", 1);
+        putCsvField(r.kind); put(",", 1);
+        putCsvField(devpath); put(",", 1);
+        putCsvField(vendor_id); put(",", 1);
+        putCsvField(product_id); put(",", 1);
+        putCsvField(manufacturer); put(",", 1);
+        putCsvField(product); put(",", 1);
+        putCsvField(r.target); put(",", 1);
+        putCsvField(capacity); put(",", 1);
+        put(r.is_storage ? "1," : "0,", 2);
+        put(r.ok ? "1," : "0,", 2);
+        putUInt(r.bytes); put(",", 1);
+        putDouble(r.seconds); put(",", 1);
+        putDouble(r.mb_per_sec); put(",", 1);
+        putUInt(r.ops); put(",", 1);
+        putDouble(r.ops_per_sec); put(",", 1);
+        putDouble(r.p50_us); put(",", 1);
+        putDouble(r.p90_us); put(",", 1);
+        putDouble(r.p99_us); put(",", 1);
+        putDouble(r.max_us); put(",", 1);
+        putCsvField(r.error);
+        put("\n", 1);
+    }
+}
+
+} // namespace
+
+ResultSink* ResultSink::open(const std::string& spec) {
+    size_t colon = spec.find(':');
+    if (colon == std::string::npos) {
+        syslog(LOG_ERR, "[Sink] Неверная спецификация вывода '%s' (ожидается jsonl:ПУТЬ или csv:ПУТЬ).", spec.c_str());
+        return nullptr;
+    }
+    std::string format_name = spec.substr(0, colon);
+    std::string path = spec.substr(colon + 1);
+    Format format;
+    if (format_name == "jsonl" || format_name == "json") {
+        format = Format::JsonLines;
+    } else if (format_name == "csv") {
+        format = Format::Csv;
+    } else {
+        syslog(LOG_ERR, "[Sink] Неизвестный формат вывода '%s'.", format_name.c_str());
+        return nullptr;
+    }
+    if (path.empty()) {
+        syslog(LOG_ERR, "[Sink] Не задан путь вывода в '%s'.", spec.c_str());
+        return nullptr;
+    }
+
+    if (path == "-") {
+        return new ResultSink(format, STDOUT_FILENO, false, false, "stdout");
+    }
+
+    int fd;
+    struct stat st;
+    bool is_fifo = stat(path.c_str(), &st) == 0 && S_ISFIFO(st.st_mode);
+    if (is_fifo) {
+        // O_RDWR: открытие не блокируется без читателя и не даёт EPIPE;
+        // при переполнении канала записи отбрасываются, а не тормозят демон
+        fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    } else {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    }
+    if (fd < 0) {
+        syslog(LOG_ERR, "[Sink] Не удалось открыть %s: %s", path.c_str(), strerror(errno));
+        return nullptr;
+    }
+    return new ResultSink(format, fd, true, is_fifo, path);
+}
+
+ResultSink::ResultSink(Format format, int fd, bool owns_fd, bool is_fifo, const std::string& path)
+ : format_(format), fd_(fd), owns_fd_(owns_fd), is_fifo_(is_fifo), path_(path),
+   pending_(kBufferSize), writing_(kBufferSize)
+{
+    if (format_ == Format::Csv) {
+        struct stat st;
+        // Заголовок не дублируем при дозаписи в существующий файл
+        if (fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+            writeCsvHeader();
+        }
+    }
+    flusher_ = std::thread(&ResultSink::flusherLoop, this);
+    syslog(LOG_INFO, "[Sink] Вывод результатов (%s) в %s.", format_ == Format::Csv ? "CSV" : "JSON Lines", path_.c_str());
+}
+
+ResultSink::~ResultSink() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+    flush();
+    if (dropped_ > 0) {
+        syslog(LOG_WARNING, "[Sink] %s: отброшено %llu записей (получатель не успевал читать).", path_.c_str(), dropped_);
+    }
+    if (owns_fd_) {
+        close(fd_);
+    }
+}
+
+void ResultSink::writeCsvHeader() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t len = strlen(kCsvHeader);
+    memcpy(&pending_[pending_len_], kCsvHeader, len);
+    pending_len_ += len;
+}
+
+void ResultSink::write(const ResultRecord& record) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (kBufferSize - pending_len_ < kRecordSize) {
+        // Буфер заполнен - сбрасываем сами, не дожидаясь фонового потока
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+    bool was_empty = pending_len_ == 0;
+    serialize(record);
+    if (was_empty) {
+        cv_.notify_one();
+    }
+}
+
+void ResultSink::flush() {
+    std::lock_guard<std::mutex> write_lock(write_mutex_);
+    size_t len;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_len_ == 0) return;
+        pending_.swap(writing_);
+        len = pending_len_;
+        pending_len_ = 0;
+    }
+    writeAll(writing_.data(), len);
+}
+
+void ResultSink::writeAll(const char* data, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        size_t chunk = len - done;
+        if (is_fifo_ && chunk > PIPE_BUF) {
+            // В канал атомарно пишется не больше PIPE_BUF: режем пачку по концу записи,
+            // тогда при переполнении EAGAIN отбрасывает только целые записи
+            size_t cut = PIPE_BUF;
+            while (cut > 0 && data[done + cut - 1] != '\n') --cut;
+            chunk = cut > 0 ? cut : PIPE_BUF;
+        }
+        ssize_t n = ::write(fd_, data + done, chunk);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                syslog(LOG_ERR, "[Sink] Ошибка записи в %s: %s", path_.c_str(), strerror(errno));
+            }
+            dropped_ += std::count(data + done, data + len, '\n');
+            return;
+        }
+        done += n;
+    }
+}
+
+void ResultSink::flusherLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        cv_.wait(lock, [this] { return pending_len_ > 0 || stopping_; });
+        if (stopping_) break;
+        // Даём остальным тестам пачки дописать свои записи
+        cv_.wait_for(lock, kLinger, [this] { return stopping_; });
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+void ResultSink::serialize(const ResultRecord& record) {
+    RecordWriter writer(pending_.data(), pending_len_);
+    writer.record(format_, record);
+    pending_len_ = writer.len;
+}
+
+size_t ResultSink::format(Format format, const ResultRecord& record, char* buf) {
+    RecordWriter writer(buf, 0);
+    writer.record(format, record);
+    return writer.len;
+}
+
+std::string ResultSink::jsonString(const char* s) {
+    char buf[kFieldSize + 2];
+    RecordWriter writer(buf, 0);
+    writer.putJsonString(s);
+    return std::string(buf, writer.len);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "DeviceInfo.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstddef>
+
+// Одна запись результата. Поля ссылаются на чужие строки и не копируются.
+struct ResultRecord {
+    const char* kind = "";               // "device_info", "read_test", "duplicate", ...
+    const DeviceInfo* device = nullptr;  // Может быть nullptr
+    const char* target = "";             // Блочное устройство / путь
+    bool is_storage = false;
+    bool ok = false;
+    unsigned long long bytes = 0;
+    double seconds = 0.0;
+    double mb_per_sec = 0.0;
+    // Операционные тесты (ФС): число операций, скорость и задержки в микросекундах
+    unsigned long long ops = 0;
+    double ops_per_sec = 0.0;
+    double p50_us = 0.0;
+    double p90_us = 0.0;
+    double p99_us = 0.0;
+    double max_us = 0.0;
+    const char* error = "";
+};
+
+// Потоковый вывод результатов в JSON Lines или CSV: stdout, FIFO или файл (дозапись).
+// Записи сериализуются в заранее выделенные буферы и сбрасываются пачками
+// фоновым потоком, так что серия завершившихся тестов даёт один write().
+class ResultSink {
+public:
+    enum class Format { JsonLines, Csv };
+
+    // spec: "jsonl:ПУТЬ" или "csv:ПУТЬ", ПУТЬ "-" означает stdout. nullptr при ошибке.
+    static ResultSink* open(const std::string& spec);
+    ~ResultSink();
+
+    void write(const ResultRecord& record);
+    void flush();
+
+    // Наибольший размер одной сериализованной записи
+    static const size_t kRecordSize = 4096;
+
+    // Та же сериализация для кэша результатов: buf на kRecordSize байт, возвращает длину
+    static size_t format(Format format, const ResultRecord& record, char* buf);
+    static std::string jsonString(const char* s);
+
+    const std::string& path() const { return path_; }
+
+private:
+    ResultSink(Format format, int fd, bool owns_fd, bool is_fifo, const std::string& path);
+
+    // Запись прямо в pending_ без выделения памяти
+    void serialize(const ResultRecord& record);
+    void writeCsvHeader();
+    void writeAll(const char* data, size_t len);
+    void flusherLoop();
+
+    static const size_t kBufferSize = 64 * 1024;
+
+    Format format_;
+    int fd_;
+    bool owns_fd_;
+    bool is_fifo_;                    // Неблокирующий канал: пишем порциями до PIPE_BUF
+    std::string path_;
+
+    std::vector<char> pending_;       // Накопленные записи, ждущие сброса
+    size_t pending_len_ = 0;
+    std::vector<char> writing_;       // Буфер, который сейчас пишется в fd
+    unsigned long long dropped_ = 0;  // Отброшенные записи
+
+    std::mutex mutex_;                // pending_
+    std::mutex write_mutex_;          // Порядок write() в fd
+    std::condition_variable cv_;
+    std::thread flusher_;
+    bool stopping_ = false;
+};
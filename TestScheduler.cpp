@@ -0,0 +1,87 @@
+#include "TestScheduler.h"
+#include <syslog.h>
+
+TestScheduler::~TestScheduler() {
+    shutdown();
+}
+
+bool TestScheduler::parseProfile(const std::string& name, TestProfile& profile) {
+    if (name.empty() || name == "default") profile = TestProfile::Default;
+    else if (name == "read") profile = TestProfile::Read;
+    else if (name == "fs") profile = TestProfile::FsBench;
+    else if (name == "full") profile = TestProfile::Full;
+    else return false;
+    return true;
+}
+
+const char* TestScheduler::profileName(TestProfile profile) {
+    switch (profile) {
+        case TestProfile::Read: return "read";
+        case TestProfile::FsBench: return "fs";
+        case TestProfile::Full: return "full";
+        default: return "default";
+    }
+}
+
+void TestScheduler::reap() {
+    for (auto it = jobs_.begin(); it != jobs_.end();) {
+        if (it->second->done.load()) {
+            it->second->thread.join();
+            it = jobs_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool TestScheduler::start(const DeviceInfo& info, bool is_storage_device, TestProfile profile, std::string& error) {
+    reap();
+    if (jobs_.count(info.devpath)) {
+        error = "тест уже выполняется";
+        return false;
+    }
+
+    std::unique_ptr<Job> job(new Job);
+    job->profile = profile;
+    job->started = std::chrono::steady_clock::now();
+    Job* raw = job.get();
+    // DeviceInfo копируется: карта устройств принадлежит циклу событий
+    raw->thread = std::thread([info, is_storage_device, profile, raw] {
+        ResultDisplay::prepareAndDisplay(info, is_storage_device, profile, &raw->cancel);
+        raw->done.store(true);
+    });
+    jobs_[info.devpath] = std::move(job);
+    syslog(LOG_INFO, "[Scheduler] Запущен тест '%s' для %s", profileName(profile), info.devpath.c_str());
+    return true;
+}
+
+bool TestScheduler::cancel(const std::string& devpath) {
+    reap();
+    auto it = jobs_.find(devpath);
+    if (it == jobs_.end()) return false;
+    it->second->cancel.store(true);
+    syslog(LOG_INFO, "[Scheduler] Запрошена отмена теста для %s", devpath.c_str());
+    return true;
+}
+
+TestScheduler::JobInfo TestScheduler::job(const std::string& devpath) {
+    reap();
+    JobInfo info;
+    auto it = jobs_.find(devpath);
+    if (it != jobs_.end()) {
+        info.running = true;
+        info.profile = it->second->profile;
+        info.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - it->second->started).count();
+    }
+    return info;
+}
+
+void TestScheduler::shutdown() {
+    for (auto it = jobs_.begin(); it != jobs_.end(); ++it) {
+        it->second->cancel.store(true);
+    }
+    for (auto it = jobs_.begin(); it != jobs_.end(); ++it) {
+        it->second->thread.join();
+    }
+    jobs_.clear();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "DeviceInfo.h"
+#include "ResultDisplay.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+// Тесты устройств в отдельных потоках, чтобы не блокировать цикл событий.
+// Не более одного теста на устройство; все методы вызываются из цикла событий.
+class TestScheduler {
+public:
+    struct JobInfo {
+        bool running = false;
+        TestProfile profile = TestProfile::Default;
+        double seconds = 0.0;
+    };
+
+    ~TestScheduler();
+
+    bool start(const DeviceInfo& info, bool is_storage_device, TestProfile profile, std::string& error);
+    // Кооперативная отмена: тест увидит флаг на следующем блоке/операции
+    bool cancel(const std::string& devpath);
+    JobInfo job(const std::string& devpath);
+    void shutdown();
+
+    static bool parseProfile(const std::string& name, TestProfile& profile);
+    static const char* profileName(TestProfile profile);
+
+private:
+    struct Job {
+        std::thread thread;
+        std::atomic<bool> cancel{false};
+        std::atomic<bool> done{false};
+        TestProfile profile = TestProfile::Default;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    void reap();
+
+    std::map<std::string, std::unique_ptr<Job>> jobs_;
+};
@@ -20,7 +20,7 @@ UdevMonitor::~UdevMonitor() {
     }
 }
 
-bool UdevMonitor::initialize() {
+bool UdevMonitor::initialize(const std::vector<Filter>& filters) {
     udev_context_ = udev_new();
     if (!udev_context_) {
         syslog(LOG_CRIT, "[UdevMonitor] Не удалось создать объект udev.");
@@ -34,11 +34,20 @@ bool UdevMonitor::initialize() {
         return false;
     }
 
-    if (udev_monitor_filter_add_match_subsystem_devtype(udev_monitor_, "usb", "usb_device") < 0) {
-         syslog(LOG_ERR, "[UdevMonitor] Не удалось добавить фильтр udev 'usb/usb_device'.");
+    // Без фильтров сокет получает все события системы - это почти всегда ошибка конфигурации
+    if (filters.empty()) {
+        syslog(LOG_WARNING, "[UdevMonitor] Не задано ни одного фильтра udev.");
     }
-    if (udev_monitor_filter_add_match_subsystem_devtype(udev_monitor_, "block", NULL) < 0) {
-         syslog(LOG_ERR, "[UdevMonitor] Не удалось добавить фильтр udev 'block'.");
+    std::string filters_desc;
+    for (size_t i = 0; i < filters.size(); ++i) {
+        const Filter& f = filters[i];
+        const char* devtype = f.devtype.empty() ? NULL : f.devtype.c_str();
+        std::string name = f.subsystem + (devtype ? "/" + f.devtype : "");
+        if (udev_monitor_filter_add_match_subsystem_devtype(udev_monitor_, f.subsystem.c_str(), devtype) < 0) {
+            syslog(LOG_ERR, "[UdevMonitor] Не удалось добавить фильтр udev '%s'.", name.c_str());
+            continue;
+        }
+        filters_desc += (filters_desc.empty() ? "" : ", ") + name;
     }
 
     if (udev_monitor_enable_receiving(udev_monitor_) < 0) {
@@ -52,7 +61,7 @@ bool UdevMonitor::initialize() {
          return false;
     }
 
-    syslog(LOG_INFO, "[UdevMonitor] Монитор udev настроен и запущен (fd=%d). Слушаем события usb и block.", udev_fd_);
+    syslog(LOG_INFO, "[UdevMonitor] Монитор udev настроен и запущен (fd=%d). Фильтры: %s.", udev_fd_, filters_desc.c_str());
     return true;
 }
 
@@ -68,13 +77,21 @@ void UdevMonitor::run(DeviceEventCallback callback) {
 
     while (running_flag_.load()) {
         fd_set fds;
+        fd_set wfds;
         FD_ZERO(&fds);
+        FD_ZERO(&wfds);
         FD_SET(udev_fd_, &fds);
+        int max_fd = udev_fd_;
+        for (auto it = watches_.begin(); it != watches_.end(); ++it) {
+            if (it->second.want_read) FD_SET(it->first, &fds);
+            if (it->second.want_write) FD_SET(it->first, &wfds);
+            if (it->first > max_fd) max_fd = it->first;
+        }
         struct timeval tv;
         tv.tv_sec = 1; 
         tv.tv_usec = 0;
 
-        int ret = select(udev_fd_ + 1, &fds, NULL, NULL, &tv);
+        int ret = select(max_fd + 1, &fds, &wfds, NULL, &tv);
 
         if (!running_flag_.load()) {
             break;
@@ -106,10 +123,59 @@ void UdevMonitor::run(DeviceEventCallback callback) {
                  udev_device_unref(dev);
             }
         }
+
+        if (ret > 0 && !watches_.empty()) {
+            // Копия списка: обработчики могут снимать и добавлять наблюдение
+            std::vector<int> ready;
+            for (auto it = watches_.begin(); it != watches_.end(); ++it) {
+                if (FD_ISSET(it->first, &fds) || FD_ISSET(it->first, &wfds)) ready.push_back(it->first);
+            }
+            for (size_t i = 0; i < ready.size(); ++i) {
+                auto it = watches_.find(ready[i]);
+                if (it == watches_.end()) continue;
+                FdCallback cb = it->second.callback;
+                try {
+                    cb(ready[i], FD_ISSET(ready[i], &fds) != 0, FD_ISSET(ready[i], &wfds) != 0);
+                } catch (const std::exception& e) {
+                    syslog(LOG_ERR, "[UdevMonitor] Исключение в обработчике fd %d: %s", ready[i], e.what());
+                }
+            }
+        }
+
+        if (tick_callback_) {
+            tick_callback_();
+        }
     }
      syslog(LOG_DEBUG, "[UdevMonitor] Выход из главного цикла.");
 }
 
+bool UdevMonitor::watchFd(int fd, bool want_write, FdCallback callback) {
+    if (fd < 0 || fd >= FD_SETSIZE) {
+        syslog(LOG_WARNING, "[UdevMonitor] fd %d не помещается в fd_set, наблюдение невозможно.", fd);
+        return false;
+    }
+    Watch watch;
+    watch.want_read = true;
+    watch.want_write = want_write;
+    watch.callback = callback;
+    watches_[fd] = watch;
+    return true;
+}
+
+void UdevMonitor::setWantRead(int fd, bool want_read) {
+    auto it = watches_.find(fd);
+    if (it != watches_.end()) it->second.want_read = want_read;
+}
+
+void UdevMonitor::setWantWrite(int fd, bool want_write) {
+    auto it = watches_.find(fd);
+    if (it != watches_.end()) it->second.want_write = want_write;
+}
+
+void UdevMonitor::unwatchFd(int fd) {
+    watches_.erase(fd);
+}
+
 void UdevMonitor::stop() {
     syslog(LOG_INFO, "[UdevMonitor] Получен запрос на остановку.");
     running_flag_.store(false);
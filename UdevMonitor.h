@@ -4,6 +4,8 @@
 #include <functional>
 #include <atomic>
 #include <string>
+#include <vector>
+#include <map>
 
 struct udev_device;
 
@@ -11,11 +13,30 @@ class UdevMonitor {
 public:
     using DeviceEventCallback = std::function<void(struct udev_device* dev)>;
 
+    // Фильтр сокета udev; пустой devtype - любой тип устройства подсистемы
+    struct Filter {
+        std::string subsystem;
+        std::string devtype;
+    };
+
     UdevMonitor();
     UdevMonitor(std::atomic<bool> &running_flag);
     ~UdevMonitor();
 
-    bool initialize();
+    bool initialize(const std::vector<Filter>& filters);
+
+    // Дополнительные дескрипторы, обслуживаемые тем же циклом (управляющий сокет и т.п.).
+    // Обработчик вызывается из run(); менять наблюдение из обработчика можно.
+    // false, если fd не помещается в fd_set (>= FD_SETSIZE).
+    using FdCallback = std::function<void(int fd, bool readable, bool writable)>;
+    bool watchFd(int fd, bool want_write, FdCallback callback);
+    void setWantRead(int fd, bool want_read);
+    void setWantWrite(int fd, bool want_write);
+    void unwatchFd(int fd);
+
+    // Вызывается на каждой итерации цикла, не реже раза в секунду (таймауты и т.п.)
+    using TickCallback = std::function<void()>;
+    void setTickCallback(TickCallback callback) { tick_callback_ = callback; }
 
     void run(DeviceEventCallback callback);
 
@@ -26,4 +47,12 @@ private:
     struct udev_monitor* udev_monitor_ = nullptr;
     int udev_fd_ = -1;
     std::atomic<bool>& running_flag_;
+
+    struct Watch {
+        bool want_read;
+        bool want_write;
+        FdCallback callback;
+    };
+    std::map<int, Watch> watches_;
+    TickCallback tick_callback_;
 };
\ No newline at end of file
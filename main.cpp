@@ -1,15 +1,208 @@
 #include "Application.h"
+#include "ImageDuplicator.h"
+#include "ResultDisplay.h"
+#include "FsBenchmark.h"
 #include <iostream>
-#include <cstring> 
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <cerrno>
+#include <getopt.h>
+#include <syslog.h>
+#include <unistd.h>
+
+static void printUsage(const char* prog) {
+    std::cout << "Использование: " << prog << " [-d] [-n] [-o ФОРМАТ:ПУТЬ]... [-F] [-b КАТАЛОГ] [-j N] [-c ОБРАЗ [-V] [-t ЦЕЛЬ]...] [-s СОКЕТ]\n"
+              << "  -d, --daemon          запуск в режиме демона\n"
+              << "  -n, --no-gui          не показывать окно zenity и не создавать текстовый отчёт\n"
+              << "  -o, --output ФОРМАТ:ПУТЬ\n"
+              << "                        потоковый вывод результатов: ФОРМАТ jsonl или csv,\n"
+              << "                        ПУТЬ - файл (дозапись), FIFO или '-' (stdout, не в режиме демона);\n"
+              << "                        можно указать несколько раз\n"
+              << "  -F, --fs-bench        тест файловой системы смонтированного накопителя после теста чтения\n"
+              << "  -b, --fs-bench-dir КАТАЛОГ\n"
+              << "                        выполнить тест файловой системы в КАТАЛОГЕ и выйти\n"
+              << "  -j, --fs-threads N    число рабочих потоков теста файловой системы (по умолчанию 4)\n"
+              << "  -c, --duplicate ОБРАЗ записывать образ на каждый подключенный накопитель\n"
+              << "  -V, --verify          проверять записанные данные после записи\n"
+              << "  -t, --target ЦЕЛЬ     записать образ на ЦЕЛЬ (файл, loop-устройство) и выйти;\n"
+              << "                        можно указать несколько раз\n"
+              << "  -s, --control-socket СОКЕТ\n"
+              << "                        управляющий сокет для usb_monitor_ctl (по умолчанию "
+              << ControlProtocol::kDefaultSocketPath << ");\n"
+              << "                        пустая строка отключает\n"
+              << "  -h, --help            эта справка\n";
+}
+
+// Демон делает chdir("/"), поэтому относительный путь в спецификации вывода делаем абсолютным
+static std::string absoluteSinkSpec(const std::string& spec) {
+    size_t colon = spec.find(':');
+    if (colon == std::string::npos || colon + 1 >= spec.size()) return spec;
+    std::string path = spec.substr(colon + 1);
+    if (path == "-" || path[0] == '/') return spec;
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) return spec;
+    return spec.substr(0, colon + 1) + cwd + "/" + path;
+}
+
+// Человекочитаемый вывод в stdout не смешиваем с потоковым выводом туда же
+static bool sinksUseStdout(const std::vector<std::string>& specs) {
+    for (size_t i = 0; i < specs.size(); ++i) {
+        size_t colon = specs[i].find(':');
+        if (colon != std::string::npos && specs[i].compare(colon + 1, std::string::npos, "-") == 0) return true;
+    }
+    return false;
+}
+
+static bool openSinks(const std::vector<std::string>& specs) {
+    for (size_t i = 0; i < specs.size(); ++i) {
+        if (!ResultDisplay::addSink(specs[i])) {
+            std::cerr << "Не удалось открыть вывод результатов: " << specs[i] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Прямой режим дублирования без udev: удобно для файлов и loop-устройств
+static int runDuplicatorDirect(const DuplicatorConfig& config, const std::vector<std::string>& targets,
+                               const std::vector<std::string>& sink_specs) {
+    openlog("usb_monitor_dup", LOG_PID | LOG_PERROR, LOG_USER);
+    if (!openSinks(sink_specs)) {
+        closelog();
+        return 1;
+    }
+    ImageDuplicator duplicator(config);
+    std::vector<DuplicationResult> results = duplicator.duplicate(targets);
+
+    int failed = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const DuplicationResult& r = results[i];
+        bool ok = r.ok();
+        if (!ok) failed++;
+        if (!sink_specs.empty()) {
+            ResultDisplay::publishDuplicationResult(r);
+        }
+        if (sinksUseStdout(sink_specs)) continue;
+        std::cout << r.target << ": " << (ok ? "OK" : "ОШИБКА")
+                  << ", записано " << r.bytes_written << " байт за " << r.seconds << " сек";
+        if (r.verified) std::cout << (r.verify_ok ? ", проверка пройдена" : ", проверка НЕ пройдена");
+        if (!r.error.empty()) std::cout << " (" << r.error << ")";
+        std::cout << std::endl;
+    }
+    ResultDisplay::closeSinks();
+    closelog();
+    return failed == 0 ? 0 : 1;
+}
+
+// Тест файловой системы произвольного каталога без udev
+static int runFsBenchDirect(const FsBenchConfig& config, const std::string& directory,
+                            const std::vector<std::string>& sink_specs) {
+    openlog("usb_monitor_fsbench", LOG_PID | LOG_PERROR, LOG_USER);
+    if (!openSinks(sink_specs)) {
+        closelog();
+        return 1;
+    }
+    std::ostream null_stream(nullptr);
+    FsBenchmark bench(config);
+    FsBenchResult result = bench.run(directory, sinksUseStdout(sink_specs) ? null_stream : std::cout);
+    ResultDisplay::publishFsBenchResult(nullptr, result);
+    ResultDisplay::closeSinks();
+    closelog();
+    return result.ok ? 0 : 1;
+}
 
 int main(int argc, char *argv[]) {
     bool run_as_daemon = false;
-    if (argc > 1 && strcmp(argv[1], "-d") == 0) {
-        run_as_daemon = true;
+    bool gui = true;
+    bool duplicate = false;
+    bool fs_bench = false;
+    std::string fs_bench_dir;
+    FsBenchConfig fs_config;
+    std::vector<std::string> sink_specs;
+    DuplicatorConfig dup_config;
+    std::vector<std::string> targets;
+    std::string control_socket = ControlProtocol::kDefaultSocketPath;
+
+    static const struct option long_options[] = {
+        {"daemon",    no_argument,       nullptr, 'd'},
+        {"no-gui",    no_argument,       nullptr, 'n'},
+        {"output",    required_argument, nullptr, 'o'},
+        {"fs-bench",  no_argument,       nullptr, 'F'},
+        {"fs-bench-dir", required_argument, nullptr, 'b'},
+        {"fs-threads", required_argument, nullptr, 'j'},
+        {"duplicate", required_argument, nullptr, 'c'},
+        {"verify",    no_argument,       nullptr, 'V'},
+        {"target",    required_argument, nullptr, 't'},
+        {"control-socket", required_argument, nullptr, 's'},
+        {"help",      no_argument,       nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "dno:Fb:j:c:Vt:s:h", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'd': run_as_daemon = true; break;
+            case 'n': gui = false; break;
+            case 'o': sink_specs.push_back(absoluteSinkSpec(optarg)); break;
+            case 'F': fs_bench = true; break;
+            case 'b': fs_bench_dir = optarg; break;
+            case 'j': fs_config.threads = static_cast<unsigned>(std::max(1, atoi(optarg))); break;
+            case 'c': duplicate = true; dup_config.image_path = optarg; break;
+            case 'V': dup_config.verify = true; break;
+            case 't': targets.push_back(optarg); break;
+            case 's': control_socket = optarg; break;
+            case 'h': printUsage(argv[0]); return 0;
+            default: printUsage(argv[0]); return 1;
+        }
+    }
+
+    if (!fs_bench_dir.empty()) {
+        return runFsBenchDirect(fs_config, fs_bench_dir, sink_specs);
+    }
+    // Демон делает chdir("/")
+    if (!control_socket.empty() && control_socket[0] != '/') {
+        char cwd[PATH_MAX];
+        if (getcwd(cwd, sizeof(cwd))) control_socket = std::string(cwd) + "/" + control_socket;
+    }
+    if (!targets.empty() && !duplicate) {
+        std::cerr << "Цели (-t) задаются только вместе с образом (-c)." << std::endl;
+        return 1;
+    }
+    if (run_as_daemon && targets.empty() && sinksUseStdout(sink_specs)) {
+        // Демон перенаправляет stdout в /dev/null
+        std::cerr << "Вывод результатов в stdout ('-') недоступен в режиме демона (-d)." << std::endl;
+        return 1;
+    }
+    if (duplicate) {
+        // Демон делает chdir("/"), поэтому путь к образу нужен абсолютный
+        char resolved[PATH_MAX];
+        if (!realpath(dup_config.image_path.c_str(), resolved)) {
+            std::cerr << "Образ недоступен: " << dup_config.image_path << ": " << strerror(errno) << std::endl;
+            return 1;
+        }
+        dup_config.image_path = resolved;
+        if (!targets.empty()) {
+            return runDuplicatorDirect(dup_config, targets, sink_specs);
+        }
     }
 
     try {
         Application app(run_as_daemon);
+        // Потоки вывода создаются после демонизации: fork() не переносит потоки
+        if (!openSinks(sink_specs)) {
+            return 1;
+        }
+        ResultDisplay::setGuiEnabled(gui);
+        app.setControlSocketPath(control_socket);
+        if (fs_bench) {
+            ResultDisplay::enableFsBenchmark(fs_config);
+        }
+        if (duplicate) {
+            app.enableDuplicator(dup_config);
+        }
         return app.run();
     } catch (const std::exception& e) {
         std::cerr << "Критическая ошибка при создании Application: " << e.what() << std::endl;
@@ -18,4 +211,4 @@ int main(int argc, char *argv[]) {
          std::cerr << "Неизвестная критическая ошибка при создании Application." << std::endl;
          return 1;
     }
-}
\ No newline at end of file
+}